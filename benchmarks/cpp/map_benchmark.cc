@@ -0,0 +1,183 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Microbenchmarks for google::protobuf::Map on its own, e.g. to compare the
+// chained and open-addressing (GOOGLE_PROTOBUF_MAP_OPEN_ADDRESSING) tables,
+// and for parsing map fields.
+
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include <google/protobuf/arena.h>
+#include <google/protobuf/map.h>
+#include <google/protobuf/struct.pb.h>
+
+using google::protobuf::Arena;
+using google::protobuf::Map;
+using google::protobuf::Struct;
+
+namespace {
+
+// Keys shaped like feature names, as in map<string, double> feature stores.
+std::vector<std::string> MakeKeys(int n) {
+  std::vector<std::string> keys;
+  keys.reserve(n);
+  for (int i = 0; i < n; i++) {
+    keys.push_back("feature_" + std::to_string(i * 7919));
+  }
+  return keys;
+}
+
+void FillMap(const std::vector<std::string>& keys, Map<std::string, double>* m) {
+  for (size_t i = 0; i < keys.size(); i++) {
+    (*m)[keys[i]] = i;
+  }
+}
+
+void BM_MapStringDouble_Find(benchmark::State& state) {
+  const std::vector<std::string> keys = MakeKeys(state.range(0));
+  Map<std::string, double> m;
+  FillMap(keys, &m);
+  size_t i = 0;
+  double sum = 0;
+  while (state.KeepRunning()) {
+    sum += m.find(keys[i])->second;
+    // Visit the keys in a scattered order.
+    i = (i + 7) % keys.size();
+  }
+  benchmark::DoNotOptimize(sum);
+}
+BENCHMARK(BM_MapStringDouble_Find)->Arg(16)->Arg(10000)->Arg(1000000);
+
+void BM_MapStringDouble_FindMissing(benchmark::State& state) {
+  const std::vector<std::string> keys = MakeKeys(state.range(0));
+  const std::vector<std::string> missing = MakeKeys(2 * state.range(0));
+  Map<std::string, double> m;
+  FillMap(keys, &m);
+  size_t i = keys.size();
+  size_t found = 0;
+  while (state.KeepRunning()) {
+    found += m.count(missing[i] + "x");
+    if (++i == missing.size()) i = keys.size();
+  }
+  benchmark::DoNotOptimize(found);
+}
+BENCHMARK(BM_MapStringDouble_FindMissing)->Arg(10000);
+
+void BM_MapStringDouble_Iterate(benchmark::State& state) {
+  const std::vector<std::string> keys = MakeKeys(state.range(0));
+  Map<std::string, double> m;
+  FillMap(keys, &m);
+  double sum = 0;
+  while (state.KeepRunning()) {
+    for (const auto& entry : m) sum += entry.second;
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * m.size());
+}
+BENCHMARK(BM_MapStringDouble_Iterate)->Arg(10000);
+
+void BM_MapStringDouble_Insert(benchmark::State& state) {
+  const std::vector<std::string> keys = MakeKeys(state.range(0));
+  while (state.KeepRunning()) {
+    Map<std::string, double> m;
+    FillMap(keys, &m);
+    benchmark::DoNotOptimize(m.size());
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(BM_MapStringDouble_Insert)->Arg(10000);
+
+void BM_MapStringDouble_InsertArena(benchmark::State& state) {
+  const std::vector<std::string> keys = MakeKeys(state.range(0));
+  while (state.KeepRunning()) {
+    Arena arena;
+    Map<std::string, double>* m =
+        Arena::CreateMessage<Map<std::string, double>>(&arena);
+    FillMap(keys, m);
+    benchmark::DoNotOptimize(m->size());
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(BM_MapStringDouble_InsertArena)->Arg(10000);
+
+void BM_MapInt32Int32_Find(benchmark::State& state) {
+  const int n = state.range(0);
+  Map<int32_t, int32_t> m;
+  for (int i = 0; i < n; i++) m[i * 31] = i;
+  int i = 0;
+  int64_t sum = 0;
+  while (state.KeepRunning()) {
+    sum += m.find(i * 31)->second;
+    if (++i == n) i = 0;
+  }
+  benchmark::DoNotOptimize(sum);
+}
+BENCHMARK(BM_MapInt32Int32_Find)->Arg(10000);
+
+// Struct.fields is a map<string, Value>.  The keys are long enough not to fit
+// in a std::string's inline buffer, so every key copy allocates.
+std::string MakeSerializedStruct(int n) {
+  Struct message;
+  for (int i = 0; i < n; i++) {
+    (*message.mutable_fields())["com.example.features.feature_" +
+                                std::to_string(i * 7919)]
+        .set_number_value(i);
+  }
+  return message.SerializeAsString();
+}
+
+void BM_StructParse(benchmark::State& state) {
+  const std::string data = MakeSerializedStruct(state.range(0));
+  Struct message;
+  while (state.KeepRunning()) {
+    message.ParseFromString(data);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_StructParse)->Arg(100)->Arg(10000)->Arg(100000);
+
+void BM_StructParseArena(benchmark::State& state) {
+  const std::string data = MakeSerializedStruct(state.range(0));
+  while (state.KeepRunning()) {
+    Arena arena;
+    Struct* message = Arena::CreateMessage<Struct>(&arena);
+    message->ParseFromString(data);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_StructParseArena)->Arg(100)->Arg(10000)->Arg(100000);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,108 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Microbenchmarks for RepeatedField inline storage (the C++ generator's
+// inline_repeated_field option), on a holder laid out like a generated
+// message.
+
+#include <utility>
+
+#include "benchmark/benchmark.h"
+#include <google/protobuf/repeated_field.h>
+
+using google::protobuf::RepeatedField;
+
+namespace {
+
+// A field and its inline storage, wired up the way generated code does it.
+struct InlineHolder {
+  InlineHolder() { field.InternalUseInlineStorage(&storage); }
+  void Swap(InlineHolder* other) {
+    field.InternalSwapWithInlineStorage(&storage, &other->field,
+                                        &other->storage);
+  }
+
+  RepeatedField<int32_t> field;
+  RepeatedField<int32_t>::InlineStorage<> storage;
+};
+
+struct HeapHolder {
+  void Swap(HeapHolder* other) { field.InternalSwap(&other->field); }
+
+  RepeatedField<int32_t> field;
+};
+
+// Builds a holder with a few elements and destroys it, like parsing a
+// message with a short repeated field.
+template <typename Holder>
+void BM_RepeatedField_AddSmall(benchmark::State& state) {
+  const int n = state.range(0);
+  while (state.KeepRunning()) {
+    Holder holder;
+    for (int i = 0; i < n; i++) holder.field.Add(i);
+    benchmark::DoNotOptimize(holder.field.data());
+  }
+}
+BENCHMARK_TEMPLATE(BM_RepeatedField_AddSmall, HeapHolder)->Arg(2)->Arg(4);
+BENCHMARK_TEMPLATE(BM_RepeatedField_AddSmall, InlineHolder)->Arg(2)->Arg(4);
+
+// Moves a large field into a new holder and back, as moving a message into
+// a freshly constructed one does.
+template <typename Holder>
+void BM_RepeatedField_MoveLarge(benchmark::State& state) {
+  Holder large;
+  for (int i = 0; i < state.range(0); i++) large.field.Add(i);
+  while (state.KeepRunning()) {
+    Holder moved;
+    moved.Swap(&large);
+    benchmark::DoNotOptimize(moved.field.data());
+    large.Swap(&moved);
+  }
+}
+BENCHMARK_TEMPLATE(BM_RepeatedField_MoveLarge, HeapHolder)->Arg(5000000);
+BENCHMARK_TEMPLATE(BM_RepeatedField_MoveLarge, InlineHolder)->Arg(5000000);
+
+// The same through RepeatedField::Swap(), which does not know where the
+// inline storage is and so copies the elements.
+void BM_RepeatedField_MoveLargeWithoutStorage(benchmark::State& state) {
+  InlineHolder large;
+  for (int i = 0; i < state.range(0); i++) large.field.Add(i);
+  while (state.KeepRunning()) {
+    InlineHolder moved;
+    moved.field.Swap(&large.field);
+    benchmark::DoNotOptimize(moved.field.data());
+    large.field.Swap(&moved.field);
+  }
+}
+BENCHMARK(BM_RepeatedField_MoveLargeWithoutStorage)->Arg(5000000);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -122,6 +122,9 @@ if(protobuf_LINK_LIBATOMIC)
   target_link_libraries(libprotobuf atomic)
 endif()
 target_include_directories(libprotobuf PUBLIC ${protobuf_source_dir}/src)
+if(protobuf_MAP_OPEN_ADDRESSING)
+  target_compile_definitions(libprotobuf PUBLIC GOOGLE_PROTOBUF_MAP_OPEN_ADDRESSING)
+endif()
 if(MSVC AND protobuf_BUILD_SHARED_LIBS)
   target_compile_definitions(libprotobuf
     PUBLIC  PROTOBUF_USE_DLLS
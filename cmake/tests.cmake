@@ -114,6 +114,21 @@ foreach(proto_file ${tests_protos})
       ${protobuf_source_dir}/src/${pb_file})
 endforeach(proto_file)
 
+# This file tests C++ generator parameters, so it is compiled with them.
+set(cpp_options_test_proto
+  google/protobuf/compiler/cpp/cpp_test_repeated_field_options)
+set(cpp_options_test_parameters
+  inline_repeated_field=protobuf_unittest.TestInlineRepeatedField.values,inline_repeated_field=protobuf_unittest.TestInlineRepeatedField.doubles,contiguous_repeated_field=protobuf_unittest.TestContiguousRepeatedField.items)
+add_custom_command(
+  OUTPUT ${protobuf_source_dir}/src/${cpp_options_test_proto}.pb.cc
+  DEPENDS protoc ${protobuf_source_dir}/src/${cpp_options_test_proto}.proto
+  COMMAND protoc ${protobuf_source_dir}/src/${cpp_options_test_proto}.proto
+      --proto_path=${protobuf_source_dir}/src
+      --cpp_out=${cpp_options_test_parameters}:${protobuf_source_dir}/src
+)
+set(tests_proto_files ${tests_proto_files}
+    ${protobuf_source_dir}/src/${cpp_options_test_proto}.pb.cc)
+
 set(common_test_files
   ${protobuf_source_dir}/src/google/protobuf/arena_test_util.cc
   ${protobuf_source_dir}/src/google/protobuf/map_test_util.inc
@@ -137,6 +152,7 @@ set(tests_files
   ${protobuf_source_dir}/src/google/protobuf/compiler/cpp/cpp_bootstrap_unittest.cc
   ${protobuf_source_dir}/src/google/protobuf/compiler/cpp/cpp_move_unittest.cc
   ${protobuf_source_dir}/src/google/protobuf/compiler/cpp/cpp_plugin_unittest.cc
+  ${protobuf_source_dir}/src/google/protobuf/compiler/cpp/cpp_repeated_field_options_unittest.cc
   ${protobuf_source_dir}/src/google/protobuf/compiler/cpp/cpp_unittest.cc
   ${protobuf_source_dir}/src/google/protobuf/compiler/cpp/cpp_unittest.inc
   ${protobuf_source_dir}/src/google/protobuf/compiler/cpp/metadata_test.cc
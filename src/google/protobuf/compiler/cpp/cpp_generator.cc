@@ -108,12 +108,44 @@ bool CppGenerator::Generate(const FileDescriptor* file,
       file_options.table_driven_parsing = true;
     } else if (options[i].first == "table_driven_serialization") {
       file_options.table_driven_serialization = true;
+    } else if (options[i].first == "contiguous_repeated_field") {
+      // May be given several times, once per field, e.g.:
+      //   protoc --cpp_out=contiguous_repeated_field=pkg.Foo.bars:outdir
+      file_options.contiguous_repeated_fields.insert(options[i].second);
+    } else if (options[i].first == "inline_repeated_field") {
+      // Same form as contiguous_repeated_field.
+      file_options.inline_repeated_fields.insert(options[i].second);
     } else {
       *error = "Unknown generator option: " + options[i].first;
       return false;
     }
   }
 
+  for (const std::string& name : file_options.contiguous_repeated_fields) {
+    const FieldDescriptor* field = file->pool()->FindFieldByName(name);
+    if (field == nullptr) {
+      *error = "contiguous_repeated_field: Unknown field " + name + ".";
+      return false;
+    }
+    if (!IsContiguousRepeatedField(field, file_options)) {
+      *error = "contiguous_repeated_field: " + name +
+               " is not a repeated message field.";
+      return false;
+    }
+  }
+  for (const std::string& name : file_options.inline_repeated_fields) {
+    const FieldDescriptor* field = file->pool()->FindFieldByName(name);
+    if (field == nullptr) {
+      *error = "inline_repeated_field: Unknown field " + name + ".";
+      return false;
+    }
+    if (!IsInlineRepeatedField(field, file_options)) {
+      *error = "inline_repeated_field: " + name +
+               " is not a repeated numeric or bool field.";
+      return false;
+    }
+  }
+
   // The safe_boundary_check option controls behavior for Google-internal
   // protobuf APIs.
   if (file_options.safe_boundary_check && file_options.opensource_runtime) {
@@ -347,6 +347,30 @@ inline bool IsLazy(const FieldDescriptor* field, const Options& options) {
          !options.opensource_runtime;
 }
 
+// Should the elements of this repeated message field be allocated in
+// contiguous blocks (see RepeatedPtrField::AddContiguous())?
+inline bool IsContiguousRepeatedField(const FieldDescriptor* field,
+                                      const Options& options) {
+  return field->is_repeated() &&
+         field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE &&
+         options.contiguous_repeated_fields.count(field->full_name()) > 0;
+}
+
+// Should this repeated numeric or bool field keep its first elements in storage
+// embedded in the message (see RepeatedField::InternalUseInlineStorage())?
+inline bool IsInlineRepeatedField(const FieldDescriptor* field,
+                                  const Options& options) {
+  if (!field->is_repeated()) return false;
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_STRING:
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+    case FieldDescriptor::CPPTYPE_ENUM:
+      return false;
+    default:
+      return options.inline_repeated_fields.count(field->full_name()) > 0;
+  }
+}
+
 // Returns true if "field" is used.
 inline bool IsFieldUsed(const FieldDescriptor* /*field*/,
                         const Options& /*options*/) {
@@ -2733,6 +2733,10 @@ void MessageGenerator::GenerateStructors(io::Printer* printer) {
           !IsCord(field, options_)) {
         continue;
       }
+      if (IsInlineRepeatedField(field, options_)) {
+        // Set up in the body, once the inline storage can be pointed to.
+        continue;
+      }
 
       processed[i] = true;
       format(",\n$1$_(from.$1$_)", FieldName(field));
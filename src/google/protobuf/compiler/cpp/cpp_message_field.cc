@@ -731,6 +731,10 @@ void RepeatedMessageFieldGenerator::GenerateInlineAccessorDefinitions(
     io::Printer* printer) const {
   Formatter format(printer, variables_);
   format.Set("weak", implicit_weak_field_ ? ".weak" : "");
+  format.Set("add", !implicit_weak_field_ &&
+                            IsContiguousRepeatedField(descriptor_, options_)
+                        ? "AddContiguous"
+                        : "Add");
 
   format(
       "inline $type$* $classname$::mutable_$name$(int index) {\n"
@@ -771,7 +775,7 @@ void RepeatedMessageFieldGenerator::GenerateInlineAccessorDefinitions(
       "  return _internal_$name$(index);\n"
       "}\n"
       "inline $type$* $classname$::_internal_add_$name$() {\n"
-      "  return $name$_$weak$.Add();\n"
+      "  return $name$_$weak$.$add$();\n"
       "}\n"
       "inline $type$* $classname$::add_$name$() {\n"
       "$annotate_accessor$"
@@ -33,6 +33,7 @@
 #ifndef GOOGLE_PROTOBUF_COMPILER_CPP_OPTIONS_H__
 #define GOOGLE_PROTOBUF_COMPILER_CPP_OPTIONS_H__
 
+#include <set>
 #include <string>
 
 namespace google {
@@ -69,6 +70,12 @@ struct Options {
   std::string annotation_pragma_name;
   std::string annotation_guard_name;
   const AccessInfoMap* access_info_map = nullptr;
+  // Full names of repeated message fields whose elements are allocated in
+  // contiguous blocks when the containing message is on an arena.
+  std::set<std::string> contiguous_repeated_fields;
+  // Full names of repeated numeric fields that keep their first few elements
+  // inside the message instead of in a separate allocation.
+  std::set<std::string> inline_repeated_fields;
 };
 
 }  // namespace cpp
@@ -299,6 +299,11 @@ void RepeatedPrimitiveFieldGenerator::GeneratePrivateMembers(
       HasGeneratedMethods(descriptor_->file(), options_)) {
     format("mutable std::atomic<int> _$name$_cached_byte_size_;\n");
   }
+  if (IsInlineRepeatedField(descriptor_, options_)) {
+    format(
+        "::$proto_ns$::RepeatedField< $type$ >::InlineStorage<>\n"
+        "    $name$_inline_storage_;\n");
+  }
 }
 
 void RepeatedPrimitiveFieldGenerator::GenerateAccessorDeclarations(
@@ -385,17 +390,28 @@ void RepeatedPrimitiveFieldGenerator::GenerateMergingCode(
 void RepeatedPrimitiveFieldGenerator::GenerateSwappingCode(
     io::Printer* printer) const {
   Formatter format(printer, variables_);
-  format("$name$_.InternalSwap(&other->$name$_);\n");
+  if (IsInlineRepeatedField(descriptor_, options_)) {
+    format(
+        "$name$_.InternalSwapWithInlineStorage(&$name$_inline_storage_,\n"
+        "                                      &other->$name$_,\n"
+        "                                      &other->$name$_inline_storage_);\n");
+  } else {
+    format("$name$_.InternalSwap(&other->$name$_);\n");
+  }
 }
 
 void RepeatedPrimitiveFieldGenerator::GenerateConstructorCode(
     io::Printer* printer) const {
-  // Not needed for repeated fields.
+  if (IsInlineRepeatedField(descriptor_, options_)) {
+    Formatter format(printer, variables_);
+    format("$name$_.InternalUseInlineStorage(&$name$_inline_storage_);\n");
+  }
 }
 
 void RepeatedPrimitiveFieldGenerator::GenerateCopyConstructorCode(
     io::Printer* printer) const {
   Formatter format(printer, variables_);
+  GenerateConstructorCode(printer);
   format("$name$_.CopyFrom(from.$name$_);\n");
 }
 
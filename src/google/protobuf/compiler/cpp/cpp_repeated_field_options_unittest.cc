@@ -0,0 +1,257 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// https://developers.google.com/protocol-buffers/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Tests for the generator options in cpp_test_repeated_field_options.proto.
+
+#include <memory>
+#include <string>
+
+#include <google/protobuf/compiler/cpp/cpp_test_repeated_field_options.pb.h>
+#include <google/protobuf/compiler/cpp/cpp_generator.h>
+#include <google/protobuf/compiler/command_line_interface.h>
+#include <google/protobuf/arena.h>
+#include <google/protobuf/testing/file.h>
+#include <google/protobuf/testing/googletest.h>
+#include <gtest/gtest.h>
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace cpp {
+namespace {
+
+using protobuf_unittest::TestContiguousRepeatedField;
+using protobuf_unittest::TestInlineRepeatedField;
+
+// Whether the elements of field are stored inside *message.
+template <typename Field>
+bool IsInline(const TestInlineRepeatedField& message, const Field& field) {
+  const char* begin = reinterpret_cast<const char*>(&message);
+  const char* data = reinterpret_cast<const char*>(field.data());
+  return data >= begin && data < begin + sizeof(TestInlineRepeatedField);
+}
+
+TEST(InlineRepeatedFieldTest, ConstructorUsesInlineStorage) {
+  TestInlineRepeatedField message;
+  for (int i = 0; i < 4; i++) message.add_values(i);
+  message.add_doubles(1.5);
+  EXPECT_TRUE(IsInline(message, message.values()));
+  EXPECT_TRUE(IsInline(message, message.doubles()));
+  EXPECT_EQ(0, message.SpaceUsedLong() - sizeof(message));
+
+  message.add_other_values(1);
+  EXPECT_FALSE(IsInline(message, message.other_values()));
+
+  std::unique_ptr<TestInlineRepeatedField> heap_message(
+      new TestInlineRepeatedField);
+  heap_message->add_values(1);
+  EXPECT_TRUE(IsInline(*heap_message, heap_message->values()));
+}
+
+TEST(InlineRepeatedFieldTest, GrowsToTheHeap) {
+  TestInlineRepeatedField message;
+  for (int i = 0; i < 100; i++) message.add_values(i);
+  EXPECT_FALSE(IsInline(message, message.values()));
+  ASSERT_EQ(100, message.values_size());
+  for (int i = 0; i < 100; i++) EXPECT_EQ(i, message.values(i));
+}
+
+TEST(InlineRepeatedFieldTest, CopyConstructorUsesOwnStorage) {
+  TestInlineRepeatedField small;
+  small.add_values(1);
+  small.add_values(2);
+  TestInlineRepeatedField small_copy(small);
+  EXPECT_TRUE(IsInline(small_copy, small_copy.values()));
+  ASSERT_EQ(2, small_copy.values_size());
+  EXPECT_EQ(1, small_copy.values(0));
+  EXPECT_EQ(2, small_copy.values(1));
+
+  TestInlineRepeatedField large;
+  for (int i = 0; i < 100; i++) large.add_values(i);
+  TestInlineRepeatedField large_copy(large);
+  EXPECT_NE(large.values().data(), large_copy.values().data());
+  ASSERT_EQ(100, large_copy.values_size());
+  for (int i = 0; i < 100; i++) EXPECT_EQ(i, large_copy.values(i));
+}
+
+TEST(InlineRepeatedFieldTest, SwapKeepsHeapAllocation) {
+  TestInlineRepeatedField large, small;
+  for (int i = 0; i < 100; i++) large.add_values(i);
+  small.add_values(-1);
+  const int32* heap_data = large.values().data();
+
+  large.Swap(&small);
+  // The allocation changes owners rather than being copied.
+  EXPECT_EQ(heap_data, small.values().data());
+  EXPECT_TRUE(IsInline(large, large.values()));
+  ASSERT_EQ(1, large.values_size());
+  EXPECT_EQ(-1, large.values(0));
+  ASSERT_EQ(100, small.values_size());
+  for (int i = 0; i < 100; i++) EXPECT_EQ(i, small.values(i));
+
+  small.Swap(&large);
+  EXPECT_EQ(heap_data, large.values().data());
+  EXPECT_TRUE(IsInline(small, small.values()));
+  ASSERT_EQ(1, small.values_size());
+  EXPECT_EQ(-1, small.values(0));
+}
+
+TEST(InlineRepeatedFieldTest, SwapBothInline) {
+  TestInlineRepeatedField a, b;
+  a.add_values(1);
+  b.add_values(2);
+  b.add_values(3);
+  a.Swap(&b);
+  EXPECT_TRUE(IsInline(a, a.values()));
+  EXPECT_TRUE(IsInline(b, b.values()));
+  ASSERT_EQ(2, a.values_size());
+  EXPECT_EQ(2, a.values(0));
+  EXPECT_EQ(3, a.values(1));
+  ASSERT_EQ(1, b.values_size());
+  EXPECT_EQ(1, b.values(0));
+}
+
+TEST(InlineRepeatedFieldTest, MoveKeepsHeapAllocation) {
+  TestInlineRepeatedField large;
+  for (int i = 0; i < 100; i++) large.add_values(i);
+  const int32* heap_data = large.values().data();
+
+  TestInlineRepeatedField moved(std::move(large));
+  EXPECT_EQ(heap_data, moved.values().data());
+  EXPECT_EQ(100, moved.values_size());
+
+  TestInlineRepeatedField assigned;
+  assigned.add_values(-1);
+  assigned = std::move(moved);
+  EXPECT_EQ(heap_data, assigned.values().data());
+  EXPECT_EQ(100, assigned.values_size());
+}
+
+TEST(InlineRepeatedFieldTest, Parse) {
+  TestInlineRepeatedField source;
+  for (int i = 0; i < 3; i++) source.add_values(i);
+  for (int i = 0; i < 10; i++) source.add_doubles(i);
+  TestInlineRepeatedField message;
+  ASSERT_TRUE(message.ParseFromString(source.SerializeAsString()));
+  EXPECT_TRUE(IsInline(message, message.values()));
+  EXPECT_EQ(source.SerializeAsString(), message.SerializeAsString());
+}
+
+TEST(InlineRepeatedFieldTest, OnArena) {
+  Arena arena;
+  auto* message = Arena::CreateMessage<TestInlineRepeatedField>(&arena);
+  message->add_values(1);
+  EXPECT_FALSE(IsInline(*message, message->values()));
+  EXPECT_EQ(&arena, message->values().GetArena());
+
+  auto* other = Arena::CreateMessage<TestInlineRepeatedField>(&arena);
+  other->Swap(message);
+  ASSERT_EQ(1, other->values_size());
+  EXPECT_EQ(1, other->values(0));
+}
+
+TEST(ContiguousRepeatedFieldTest, ParseOnArena) {
+  TestContiguousRepeatedField source;
+  for (int i = 0; i < 4; i++) {
+    source.add_items()->set_value(i);
+    source.add_other_items()->set_value(i);
+  }
+  Arena arena;
+  auto* message = Arena::CreateMessage<TestContiguousRepeatedField>(&arena);
+  ASSERT_TRUE(message->ParseFromString(source.SerializeAsString()));
+  EXPECT_EQ(source.SerializeAsString(), message->SerializeAsString());
+
+  // The first growth step of items is filled with one block.
+  for (int i = 1; i < 4; i++) {
+    EXPECT_EQ(&message->items(0) + i, &message->items(i));
+  }
+  // add_items() goes through the same path as the parser.
+  const TestContiguousRepeatedField::Item* first = &message->items(0);
+  message->clear_items();
+  EXPECT_EQ(first, message->add_items());
+}
+
+TEST(ContiguousRepeatedFieldTest, OnHeap) {
+  TestContiguousRepeatedField message;
+  for (int i = 0; i < 10; i++) message.add_items()->set_value(i);
+  ASSERT_EQ(10, message.items_size());
+  EXPECT_EQ(9, message.items(9).value());
+}
+
+// Runs the C++ generator over cpp_test_repeated_field_options.proto with the
+// given parameter and returns whether it succeeded.
+bool RunGenerator(const std::string& parameter) {
+  CommandLineInterface cli;
+  CppGenerator cpp_generator;
+  cli.RegisterGenerator("--cpp_out", &cpp_generator, "");
+  std::string proto_path = "-I" + TestSourceDir();
+  std::string cpp_out = "--cpp_out=" + parameter + ":" + TestTempDir();
+  const char* argv[] = {
+      "protoc", proto_path.c_str(), cpp_out.c_str(),
+      "google/protobuf/compiler/cpp/cpp_test_repeated_field_options.proto"};
+  return cli.Run(4, argv) == 0;
+}
+
+TEST(InlineRepeatedFieldTest, GeneratorRejectsUnsupportedFields) {
+  EXPECT_TRUE(RunGenerator(
+      "inline_repeated_field=protobuf_unittest.TestInlineRepeatedField.values"));
+  // Misspelled.
+  EXPECT_FALSE(RunGenerator(
+      "inline_repeated_field=protobuf_unittest.TestInlineRepeatedField.value"));
+  // Not repeated.
+  EXPECT_FALSE(RunGenerator(
+      "inline_repeated_field=protobuf_unittest.TestInlineRepeatedField.scalar"));
+  // Enums are parsed with validation and stay out of inline storage.
+  EXPECT_FALSE(RunGenerator(
+      "inline_repeated_field=protobuf_unittest.TestInlineRepeatedField.kinds"));
+}
+
+TEST(ContiguousRepeatedFieldTest, GeneratorRejectsUnsupportedFields) {
+  EXPECT_TRUE(RunGenerator(
+      "contiguous_repeated_field="
+      "protobuf_unittest.TestContiguousRepeatedField.items"));
+  // Misspelled.
+  EXPECT_FALSE(RunGenerator(
+      "contiguous_repeated_field="
+      "protobuf_unittest.TestContiguousRepeatedField.item"));
+  // Not a message field.
+  EXPECT_FALSE(RunGenerator(
+      "contiguous_repeated_field="
+      "protobuf_unittest.TestContiguousRepeatedField.names"));
+  EXPECT_FALSE(RunGenerator(
+      "contiguous_repeated_field="
+      "protobuf_unittest.TestInlineRepeatedField.values"));
+}
+
+}  // namespace
+}  // namespace cpp
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
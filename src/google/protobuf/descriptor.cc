@@ -1379,7 +1379,14 @@ void DescriptorPool::InternalAddGeneratedFile(
   // Therefore, when we parse one, we have to be very careful to avoid using
   // any descriptor-based operations, since this might cause infinite recursion
   // or deadlock.
-  GOOGLE_CHECK(GeneratedDatabase()->Add(encoded_file_descriptor, size));
+  //
+  // Registration itself does not parse the bytes either: only the file name is
+  // read, and the symbols of all registered files are indexed the first time
+  // someone looks up a symbol or extension rather than a file by name.  The
+  // generated code itself only ever looks up its own files by name, so a
+  // binary that links many files but only uses reflection on a few of them
+  // never parses the others.
+  GOOGLE_CHECK(GeneratedDatabase()->AddUnindexed(encoded_file_descriptor, size));
 }
 
 
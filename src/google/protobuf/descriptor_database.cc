@@ -45,6 +45,33 @@ namespace google {
 namespace protobuf {
 
 namespace {
+
+// Reads the name of an encoded FileDescriptorProto.
+bool ReadEncodedFileName(const void* encoded_file_descriptor, int size,
+                         std::string* output) {
+  // Optimization:  The name should be the first field in the encoded message.
+  //   Try to just read it directly.
+  io::CodedInputStream input(
+      reinterpret_cast<const uint8*>(encoded_file_descriptor), size);
+
+  const uint32 kNameTag = internal::WireFormatLite::MakeTag(
+      FileDescriptorProto::kNameFieldNumber,
+      internal::WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+
+  if (input.ReadTagNoLastTag() == kNameTag) {
+    // Success!
+    return internal::WireFormatLite::ReadString(&input, output);
+  } else {
+    // Slow path.  Parse whole message.
+    FileDescriptorProto file_proto;
+    if (!file_proto.ParseFromArray(encoded_file_descriptor, size)) {
+      return false;
+    }
+    *output = file_proto.name();
+    return true;
+  }
+}
+
 void RecordMessageNames(const DescriptorProto& desc_proto,
                         const std::string& prefix,
                         std::set<std::string>* output) {
@@ -390,6 +417,11 @@ bool EncodedDescriptorDatabase::Add(const void* encoded_file_descriptor,
   google::protobuf::Arena arena;
   auto* file = google::protobuf::Arena::CreateMessage<FileDescriptorProto>(&arena);
   if (file->ParseFromArray(encoded_file_descriptor, size)) {
+    if (unindexed_files_.count(file->name()) > 0 ||
+        invalid_files_.count(file->name()) > 0) {
+      GOOGLE_LOG(ERROR) << "File already exists in database: " << file->name();
+      return false;
+    }
     return index_.AddFile(*file, std::make_pair(encoded_file_descriptor, size));
   } else {
     GOOGLE_LOG(ERROR) << "Invalid file descriptor data passed to "
@@ -406,58 +438,103 @@ bool EncodedDescriptorDatabase::AddCopy(const void* encoded_file_descriptor,
   return Add(copy, size);
 }
 
+bool EncodedDescriptorDatabase::AddUnindexed(
+    const void* encoded_file_descriptor, int size) {
+  std::string name;
+  if (!ReadEncodedFileName(encoded_file_descriptor, size, &name)) {
+    GOOGLE_LOG(ERROR) << "Invalid file descriptor data passed to "
+                  "EncodedDescriptorDatabase::AddUnindexed().";
+    return false;
+  }
+  if (FindEncodedFile(name).first != NULL) {
+    GOOGLE_LOG(ERROR) << "File already exists in database: " << name;
+    return false;
+  }
+  unindexed_files_[name] = std::make_pair(encoded_file_descriptor, size);
+  return true;
+}
+
+void EncodedDescriptorDatabase::IndexUnindexedFiles() {
+  if (unindexed_files_.empty()) return;
+  // Take the pending files first so that FindEncodedFile() no longer reports
+  // them as present while they are added to the index.
+  std::map<std::string, std::pair<const void*, int> > pending;
+  pending.swap(unindexed_files_);
+  google::protobuf::Arena arena;
+  for (const auto& entry : pending) {
+    auto* file = google::protobuf::Arena::CreateMessage<FileDescriptorProto>(&arena);
+    if (!file->ParseFromArray(entry.second.first, entry.second.second)) {
+      GOOGLE_LOG(DFATAL) << "Invalid file descriptor data passed to "
+                     "EncodedDescriptorDatabase::AddUnindexed(): "
+                  << entry.first;
+      // Keep the name taken so that the file is still found by name, as it
+      // was before indexing, and cannot be added a second time.
+      invalid_files_.insert(entry);
+      continue;
+    }
+    // AddFile() adds the file name before any symbol, so on a conflict the
+    // file stays findable by name along with the symbols added before the
+    // conflicting one.  Add() reports the same failure to its caller; for
+    // generated files that used to be a CHECK failure at startup.
+    if (!index_.AddFile(*file, entry.second)) {
+      GOOGLE_LOG(DFATAL) << "Conflicting symbols in file passed to "
+                     "EncodedDescriptorDatabase::AddUnindexed(): "
+                  << entry.first;
+    }
+  }
+}
+
+std::pair<const void*, int> EncodedDescriptorDatabase::FindEncodedFile(
+    const std::string& filename) {
+  std::pair<const void*, int> result = index_.FindFile(filename);
+  if (result.first == NULL) {
+    auto it = unindexed_files_.find(filename);
+    if (it != unindexed_files_.end()) {
+      result = it->second;
+    } else {
+      it = invalid_files_.find(filename);
+      if (it != invalid_files_.end()) result = it->second;
+    }
+  }
+  return result;
+}
+
 bool EncodedDescriptorDatabase::FindFileByName(const std::string& filename,
                                                FileDescriptorProto* output) {
-  return MaybeParse(index_.FindFile(filename), output);
+  return MaybeParse(FindEncodedFile(filename), output);
 }
 
 bool EncodedDescriptorDatabase::FindFileContainingSymbol(
     const std::string& symbol_name, FileDescriptorProto* output) {
+  IndexUnindexedFiles();
   return MaybeParse(index_.FindSymbol(symbol_name), output);
 }
 
 bool EncodedDescriptorDatabase::FindNameOfFileContainingSymbol(
     const std::string& symbol_name, std::string* output) {
+  IndexUnindexedFiles();
   std::pair<const void*, int> encoded_file = index_.FindSymbol(symbol_name);
   if (encoded_file.first == NULL) return false;
-
-  // Optimization:  The name should be the first field in the encoded message.
-  //   Try to just read it directly.
-  io::CodedInputStream input(reinterpret_cast<const uint8*>(encoded_file.first),
-                             encoded_file.second);
-
-  const uint32 kNameTag = internal::WireFormatLite::MakeTag(
-      FileDescriptorProto::kNameFieldNumber,
-      internal::WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
-
-  if (input.ReadTagNoLastTag() == kNameTag) {
-    // Success!
-    return internal::WireFormatLite::ReadString(&input, output);
-  } else {
-    // Slow path.  Parse whole message.
-    FileDescriptorProto file_proto;
-    if (!file_proto.ParseFromArray(encoded_file.first, encoded_file.second)) {
-      return false;
-    }
-    *output = file_proto.name();
-    return true;
-  }
+  return ReadEncodedFileName(encoded_file.first, encoded_file.second, output);
 }
 
 bool EncodedDescriptorDatabase::FindFileContainingExtension(
     const std::string& containing_type, int field_number,
     FileDescriptorProto* output) {
+  IndexUnindexedFiles();
   return MaybeParse(index_.FindExtension(containing_type, field_number),
                     output);
 }
 
 bool EncodedDescriptorDatabase::FindAllExtensionNumbers(
     const std::string& extendee_type, std::vector<int>* output) {
+  IndexUnindexedFiles();
   return index_.FindAllExtensionNumbers(extendee_type, output);
 }
 
 bool EncodedDescriptorDatabase::FindAllFileNames(
     std::vector<std::string>* output) {
+  IndexUnindexedFiles();
   index_.FindAllFileNames(output);
   return true;
 }
@@ -315,6 +315,15 @@ class PROTOBUF_EXPORT EncodedDescriptorDatabase : public DescriptorDatabase {
   // need to keep it around.
   bool AddCopy(const void* encoded_file_descriptor, int size);
 
+  // Like Add(), but only reads the file name up front.  Parsing the file and
+  // indexing its symbols and extensions is deferred until the first query
+  // that needs the full index, so lookups by file name never pay for other
+  // files.  Returns false and logs an error only if the name cannot be read or
+  // a file with the same name was already added; invalid data and symbols
+  // that conflict with other files are reported with GOOGLE_LOG(DFATAL) when
+  // the file is eventually indexed.
+  bool AddUnindexed(const void* encoded_file_descriptor, int size);
+
   // Like FindFileContainingSymbol but returns only the name of the file.
   bool FindNameOfFileContainingSymbol(const std::string& symbol_name,
                                       std::string* output);
@@ -336,6 +345,21 @@ class PROTOBUF_EXPORT EncodedDescriptorDatabase : public DescriptorDatabase {
       index_;
   std::vector<void*> files_to_delete_;
 
+  // Files added with AddUnindexed() which have not been added to index_ yet,
+  // keyed by file name.
+  std::map<std::string, std::pair<const void*, int> > unindexed_files_;
+
+  // Files added with AddUnindexed() which failed to parse when they were
+  // indexed, keyed by file name.  FindFileByName() still finds (and fails to
+  // parse) them, and they keep their name taken.
+  std::map<std::string, std::pair<const void*, int> > invalid_files_;
+
+  // Parses all files in unindexed_files_ and adds them to index_.
+  void IndexUnindexedFiles();
+
+  // Looks up a file by name in index_, unindexed_files_ and invalid_files_.
+  std::pair<const void*, int> FindEncodedFile(const std::string& filename);
+
   // If encoded_file.first is non-NULL, parse the data into *output and return
   // true, otherwise return false.
   bool MaybeParse(std::pair<const void*, int> encoded_file,
@@ -516,6 +516,110 @@ TEST(EncodedDescriptorDatabaseExtraTest, FindNameOfFileContainingSymbol) {
   EXPECT_FALSE(db.FindNameOfFileContainingSymbol("baz.Baz", &filename));
 }
 
+TEST(EncodedDescriptorDatabaseExtraTest, AddUnindexed) {
+  FileDescriptorProto file1, file2;
+  file1.set_name("foo.proto");
+  file1.set_package("foo");
+  file1.add_message_type()->set_name("Foo");
+  file2.set_name("bar.proto");
+  file2.set_package("bar");
+  file2.add_message_type()->set_name("Bar");
+  FieldDescriptorProto* extension = file2.add_extension();
+  extension->set_name("bar_ext");
+  extension->set_extendee(".foo.Foo");
+  extension->set_number(123);
+
+  std::string data1 = file1.SerializeAsString();
+  std::string data2 = file2.SerializeAsString();
+
+  EncodedDescriptorDatabase db;
+  EXPECT_TRUE(db.AddUnindexed(data1.data(), data1.size()));
+  EXPECT_TRUE(db.AddUnindexed(data2.data(), data2.size()));
+
+  // Lookups by name work before anything has been indexed.
+  FileDescriptorProto file;
+  EXPECT_TRUE(db.FindFileByName("bar.proto", &file));
+  EXPECT_EQ("bar.proto", file.name());
+  EXPECT_FALSE(db.FindFileByName("baz.proto", &file));
+
+  // Adding the same file again is detected without indexing.
+  EXPECT_FALSE(db.AddUnindexed(data1.data(), data1.size()));
+
+  // Symbol and extension lookups index the pending files.
+  std::string filename;
+  EXPECT_TRUE(db.FindNameOfFileContainingSymbol("foo.Foo", &filename));
+  EXPECT_EQ("foo.proto", filename);
+  EXPECT_TRUE(db.FindFileContainingExtension("foo.Foo", 123, &file));
+  EXPECT_EQ("bar.proto", file.name());
+  EXPECT_TRUE(db.FindFileByName("foo.proto", &file));
+  EXPECT_EQ("foo.proto", file.name());
+
+  std::vector<std::string> all_files;
+  EXPECT_TRUE(db.FindAllFileNames(&all_files));
+  EXPECT_THAT(all_files, testing::UnorderedElementsAre("foo.proto",
+                                                       "bar.proto"));
+}
+
+TEST(EncodedDescriptorDatabaseExtraTest, AddAfterAddUnindexed) {
+  FileDescriptorProto file1;
+  file1.set_name("foo.proto");
+  file1.add_message_type()->set_name("Foo");
+  std::string data1 = file1.SerializeAsString();
+
+  EncodedDescriptorDatabase db;
+  EXPECT_TRUE(db.AddUnindexed(data1.data(), data1.size()));
+  // Add() sees the pending file too.
+  EXPECT_FALSE(db.Add(data1.data(), data1.size()));
+
+  FileDescriptorProto file;
+  EXPECT_TRUE(db.FindFileContainingSymbol("Foo", &file));
+  EXPECT_EQ("foo.proto", file.name());
+  EXPECT_FALSE(db.Add(data1.data(), data1.size()));
+  EXPECT_FALSE(db.AddUnindexed(data1.data(), data1.size()));
+}
+
+TEST(EncodedDescriptorDatabaseExtraTest, AddUnindexedErrors) {
+  FileDescriptorProto file1, file2;
+  file1.set_name("foo.proto");
+  file1.set_package("foo");
+  file1.add_message_type()->set_name("Foo");
+  // bar.proto defines foo.Foo as well.
+  file2.set_name("bar.proto");
+  file2.set_package("foo");
+  file2.add_message_type()->set_name("Foo");
+  std::string data1 = file1.SerializeAsString();
+  std::string data2 = file2.SerializeAsString();
+  // The name can be read, but the rest is not a valid message.
+  std::string data3 = "\x0a\x09qux.proto\xff\xff";
+
+  EncodedDescriptorDatabase db;
+  EXPECT_TRUE(db.AddUnindexed(data1.data(), data1.size()));
+  EXPECT_TRUE(db.AddUnindexed(data2.data(), data2.size()));
+  EXPECT_TRUE(db.AddUnindexed(data3.data(), data3.size()));
+
+  std::string filename;
+#ifndef NDEBUG
+#ifdef PROTOBUF_HAS_DEATH_TEST
+  EXPECT_DEATH(db.FindNameOfFileContainingSymbol("foo.Foo", &filename),
+               "Conflicting symbols");
+#endif  // PROTOBUF_HAS_DEATH_TEST
+#else
+  // Only logged outside of debug builds; the first file to claim a symbol
+  // keeps it.
+  EXPECT_TRUE(db.FindNameOfFileContainingSymbol("foo.Foo", &filename));
+  EXPECT_EQ("bar.proto", filename);
+
+  // Files that failed to index are still there by name.
+  FileDescriptorProto file;
+  EXPECT_TRUE(db.FindFileByName("foo.proto", &file));
+  EXPECT_EQ("foo.proto", file.name());
+  EXPECT_FALSE(db.AddUnindexed(data1.data(), data1.size()));
+  EXPECT_FALSE(db.Add(data1.data(), data1.size()));
+  EXPECT_FALSE(db.AddUnindexed(data3.data(), data3.size()));
+  EXPECT_FALSE(db.Add(data3.data(), data3.size()));
+#endif  // NDEBUG
+}
+
 TEST(SimpleDescriptorDatabaseExtraTest, FindAllFileNames) {
   FileDescriptorProto f;
   f.set_name("foo.proto");
@@ -2341,6 +2341,13 @@ struct MetadataOwner {
 };
 
 void AssignDescriptorsImpl(const DescriptorTable* table, bool eager) {
+  // Reflection refers to the default instances so make sure they are
+  // initialized. This is deferred from AddDescriptors() so that linking in a
+  // file does not cost any default instance construction at startup.
+  for (int i = 0; i < table->num_sccs; i++) {
+    internal::InitSCC(table->init_default_instances[i]);
+  }
+
   // Ensure the file descriptor is added to the pool.
   {
     // This only happens once per proto file. So a global mutex to serialize
@@ -2398,12 +2405,6 @@ void AssignDescriptorsImpl(const DescriptorTable* table, bool eager) {
 }
 
 void AddDescriptorsImpl(const DescriptorTable* table) {
-  // Reflection refers to the default instances so make sure they are
-  // initialized.
-  for (int i = 0; i < table->num_sccs; i++) {
-    internal::InitSCC(table->init_default_instances[i]);
-  }
-
   // Ensure all dependent descriptors are registered to the generated descriptor
   // pool and message factory.
   int num_deps = table->num_deps;
@@ -300,6 +300,8 @@ void PROTOBUF_EXPORT AssignDescriptors(const DescriptorTable* table,
 // FileDescriptorProto for this .proto file to the global DescriptorPool for
 // generated files (DescriptorPool::generated_pool()). It ordinarily runs at
 // static initialization time, but is not used at all in LITE_RUNTIME mode.
+// It only registers the file; default instances are constructed lazily, either
+// by the first constructed message or by AssignDescriptors().
 // AddDescriptors() is *not* thread-safe.
 void PROTOBUF_EXPORT AddDescriptors(const DescriptorTable* table);
 
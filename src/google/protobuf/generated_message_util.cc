@@ -68,7 +68,8 @@ void DestroyString(const void* s) {
   static_cast<const std::string*>(s)->~string();
 }
 
-ExplicitlyConstructed<std::string> fixed_address_empty_string;
+PROTOBUF_CONSTINIT ExplicitlyConstructed<std::string>
+    fixed_address_empty_string;
 
 
 static bool InitProtobufDefaultsImpl() {
@@ -50,6 +50,10 @@
 #include <google/protobuf/map_type_handler.h>
 #include <google/protobuf/stubs/hash.h>
 
+#if defined(GOOGLE_PROTOBUF_MAP_OPEN_ADDRESSING) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #ifdef SWIG
 #error "You cannot SWIG proto headers"
 #endif
@@ -78,6 +82,11 @@ template <typename Derived, typename Key, typename T,
           WireFormatLite::FieldType value_wire_type, int default_enum_value>
 class MapField;
 
+template <typename Derived, typename Base, typename Key, typename Value,
+          WireFormatLite::FieldType kKeyFieldType,
+          WireFormatLite::FieldType kValueFieldType, int default_enum_value>
+class MapEntryImpl;
+
 template <typename Key, typename T>
 class TypeDefinedMapFieldBase;
 
@@ -227,6 +236,8 @@ struct MapPair {
   MapPair(const Key& other_first, const T& other_second)
       : first(other_first), second(other_second) {}
   explicit MapPair(const Key& other_first) : first(other_first), second() {}
+  explicit MapPair(Key&& other_first)
+      : first(std::move(other_first)), second() {}
   MapPair(const MapPair& other) : first(other.first), second(other.second) {}
 
   ~MapPair() {}
@@ -338,6 +349,7 @@ class Map {
 
   using Allocator = internal::MapAllocator<KeyValuePair>;
 
+#ifndef GOOGLE_PROTOBUF_MAP_OPEN_ADDRESSING
   // InnerMap is a generic hash-based map.  It doesn't contain any
   // protocol-buffer-specific logic.  It is a chaining hash map with the
   // additional feature that some buckets can be converted to use an ordered
@@ -1006,6 +1018,477 @@ class Map {
     GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(InnerMap);
   };  // end of class InnerMap
 
+#else  // GOOGLE_PROTOBUF_MAP_OPEN_ADDRESSING
+
+  // InnerMap is a generic hash-based map.  This variant is an open-addressing
+  // table in the style of SwissTable.  It is selected by defining
+  // GOOGLE_PROTOBUF_MAP_OPEN_ADDRESSING, which changes the layout of Map: the
+  // library and all code using it must agree on the setting.  The CMake
+  // option protobuf_MAP_OPEN_ADDRESSING, the configure flag
+  // --enable-map-open-addressing and the Bazel flag //:map_open_addressing
+  // set it for the library and export it to dependents and pkg-config users.
+  //
+  // Some implementation details:
+  // 1. KeyValuePairs are stored inline in a flat array of slots, so no node is
+  //    allocated per element.  The values themselves are still allocated by
+  //    the outer Map, so pointers and references to elements stay valid until
+  //    the element is erased.
+  // 2. Each slot has a control byte: kEmpty, kDeleted, or the low 7 bits of
+  //    the key's hash.  Lookups compare the control bytes of a whole group of
+  //    kGroupWidth slots at once (with SSE2 where available) and only compare
+  //    keys whose 7 hash bits match.
+  // 3. The number of slots is a power of two and a multiple of kGroupWidth.
+  //    Groups are probed in triangular order, which visits every group.
+  // 4. The table grows when it would become more than 7/8 full, counting
+  //    erased slots that are still needed to keep probe sequences intact.
+  // 5. Growing the table moves slots.  As with the chained InnerMap,
+  //    mutations do not invalidate iterators: an iterator remembers the table
+  //    generation it was positioned in and, if the table has been rehashed
+  //    since, finds its element again by key.  Erasing never moves other
+  //    slots.
+  // 6. InnerMap's key is TrivialKey, so slots are trivially destructible and
+  //    InnerMap's destructor can be skipped when it is arena-allocated.
+  class InnerMap : private hasher {
+   public:
+    using Value = value_type*;
+
+    explicit InnerMap(size_type n) : InnerMap(nullptr, n) {}
+    InnerMap(Arena* arena, size_type n)
+        : hasher(),
+          num_elements_(0),
+          num_slots_(0),
+          growth_left_(0),
+          seed_(Seed()),
+          generation_(0),
+          ctrl_(EmptyGroup()),
+          slots_(nullptr),
+          alloc_(arena) {
+      if (n > 0) Resize(TableSize(n));
+      static_assert(
+          std::is_trivially_destructible<KeyValuePair>::value,
+          "We require KeyValuePair to be trivially destructible so that we can "
+          "skip InnerMap's destructor when it's arena allocated.");
+    }
+
+    ~InnerMap() {
+      if (num_slots_ > 0) {
+        Dealloc<ctrl_t>(ctrl_, num_slots_);
+        Dealloc<KeyValuePair>(slots_, num_slots_);
+      }
+    }
+
+   private:
+    using ctrl_t = int8;
+    enum : ctrl_t { kEmpty = -128, kDeleted = -2 };
+    enum { kGroupWidth = 16 };
+
+    // The control bytes of kGroupWidth consecutive slots.
+    class Group {
+     public:
+      explicit Group(const ctrl_t* pos) {
+#ifdef __SSE2__
+        ctrl_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+#else
+        memcpy(ctrl_, pos, kGroupWidth);
+#endif
+      }
+
+      // Returns a bitmask of the slots whose control byte is h.
+      uint32 Match(ctrl_t h) const {
+#ifdef __SSE2__
+        return static_cast<uint32>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h), ctrl_)));
+#else
+        uint32 mask = 0;
+        for (int i = 0; i < kGroupWidth; i++) {
+          mask |= static_cast<uint32>(ctrl_[i] == h) << i;
+        }
+        return mask;
+#endif
+      }
+
+      uint32 MatchEmpty() const { return Match(kEmpty); }
+
+      // kEmpty and kDeleted are the only negative control bytes.
+      uint32 MatchEmptyOrDeleted() const {
+#ifdef __SSE2__
+        return static_cast<uint32>(_mm_movemask_epi8(ctrl_));
+#else
+        uint32 mask = 0;
+        for (int i = 0; i < kGroupWidth; i++) {
+          mask |= static_cast<uint32>(ctrl_[i] < 0) << i;
+        }
+        return mask;
+#endif
+      }
+
+     private:
+#ifdef __SSE2__
+      __m128i ctrl_;
+#else
+      ctrl_t ctrl_[kGroupWidth];
+#endif
+    };
+
+    // iterator and const_iterator are instantiations of iterator_base.
+    template <typename KeyValueType>
+    class iterator_base {
+     public:
+      using reference = KeyValueType&;
+      using pointer = KeyValueType*;
+
+      // Invariants:
+      // index_ is correct while generation_ matches the map's generation_.
+      // value_ is the element's value as of the last access through this
+      // iterator; values are never moved, so value_->first identifies the
+      // element after a rehash.  The outer Map sets the value of a newly
+      // inserted element through the iterator insert() returns, so value_ is
+      // only null until then.
+      iterator_base()
+          : m_(nullptr), index_(0), generation_(0), value_(nullptr) {}
+
+      // Positions the iterator at the first element of *m.
+      explicit iterator_base(const InnerMap* m)
+          : m_(m), index_(0), generation_(m->generation_) {
+        SkipEmptyOrDeleted();
+      }
+
+      // Positions the iterator at the element in slot index.
+      iterator_base(const InnerMap* m, size_type index)
+          : m_(m),
+            index_(index),
+            generation_(m->generation_),
+            value_(m->slots_[index].value()) {}
+
+      // Any iterator_base can convert to any other.  This is overkill, and we
+      // rely on the enclosing class to use it wisely.  The standard "iterator
+      // can convert to const_iterator" is OK but the reverse direction is not.
+      template <typename U>
+      explicit iterator_base(const iterator_base<U>& it)
+          : m_(it.m_),
+            index_(it.index_),
+            generation_(it.generation_),
+            value_(it.value_) {}
+
+      reference operator*() const {
+        revalidate_if_necessary();
+        KeyValuePair& kv = m_->slots_[index_];
+        if (PROTOBUF_PREDICT_FALSE(value_ == nullptr)) value_ = kv.value();
+        return kv;
+      }
+      pointer operator->() const { return &(operator*()); }
+
+      friend bool operator==(const iterator_base& a, const iterator_base& b) {
+        if (a.m_ != b.m_) return false;
+        if (a.m_ == nullptr) return true;
+        a.revalidate_if_necessary();
+        b.revalidate_if_necessary();
+        return a.index_ == b.index_;
+      }
+      friend bool operator!=(const iterator_base& a, const iterator_base& b) {
+        return !(a == b);
+      }
+
+      iterator_base& operator++() {
+        revalidate_if_necessary();
+        ++index_;
+        SkipEmptyOrDeleted();
+        return *this;
+      }
+
+      iterator_base operator++(int /* unused */) {
+        iterator_base tmp = *this;
+        ++*this;
+        return tmp;
+      }
+
+      // Moves forward to the next full slot, or becomes end() if there is none.
+      void SkipEmptyOrDeleted() {
+        while (index_ < m_->num_slots_ && m_->ctrl_[index_] < 0) ++index_;
+        if (index_ == m_->num_slots_) {
+          *this = iterator_base();
+        } else {
+          value_ = m_->slots_[index_].value();
+        }
+      }
+
+      // If the map has been rehashed since index_ was computed, look the
+      // element up again.
+      void revalidate_if_necessary() const {
+        GOOGLE_DCHECK(m_ != nullptr);
+        if (PROTOBUF_PREDICT_FALSE(generation_ != m_->generation_)) {
+          Revalidate();
+        }
+      }
+
+      PROTOBUF_NOINLINE void Revalidate() const {
+        GOOGLE_DCHECK(value_ != nullptr);
+        const TrivialKey key(value_->first);
+        index_ = m_->FindIndex(key, m_->Hash(key));
+        GOOGLE_DCHECK_NE(index_, kNotFound);
+        generation_ = m_->generation_;
+      }
+
+      const InnerMap* m_;
+      mutable size_type index_;
+      mutable size_type generation_;
+      mutable Value value_;
+    };
+
+   public:
+    using iterator = iterator_base<KeyValuePair>;
+    using const_iterator = iterator_base<const KeyValuePair>;
+
+    iterator begin() { return iterator(this); }
+    iterator end() { return iterator(); }
+    const_iterator begin() const { return const_iterator(this); }
+    const_iterator end() const { return const_iterator(); }
+
+    void clear() {
+      if (num_slots_ > 0) {
+        memset(ctrl_, kEmpty, num_slots_);
+      }
+      num_elements_ = 0;
+      growth_left_ = MaxLoad(num_slots_);
+    }
+
+    const hasher& hash_function() const { return *this; }
+
+    static size_type max_size() {
+      return static_cast<size_type>(1) << (sizeof(void**) >= 8 ? 60 : 28);
+    }
+    size_type size() const { return num_elements_; }
+    bool empty() const { return size() == 0; }
+
+    iterator find(const TrivialKey& k) { return iterator(FindHelper(k)); }
+    const_iterator find(const TrivialKey& k) const {
+      return const_iterator(FindHelper(k));
+    }
+    bool contains(const TrivialKey& k) const {
+      return FindIndex(k, Hash(k)) != kNotFound;
+    }
+
+    // In traditional C++ style, this performs "insert if not present."
+    std::pair<iterator, bool> insert(const KeyValuePair& kv) {
+      const uint64 hash = Hash(kv.key());
+      const size_type found = FindIndex(kv.key(), hash);
+      // Case 1: key was already present.
+      if (found != kNotFound) {
+        return std::make_pair(iterator(this, found), false);
+      }
+      // Case 2: insert.
+      const size_type index = PrepareInsert(hash);
+      alloc_.construct(&slots_[index], kv);
+      return std::make_pair(iterator(this, index), true);
+    }
+
+    // The same, but if an insertion is necessary then the value portion of the
+    // inserted key-value pair is null.
+    std::pair<iterator, bool> insert(const TrivialKey& k) {
+      return insert(KeyValuePair(k, Value()));
+    }
+
+    // Returns iterator so that outer map can update the TrivialKey to point to
+    // the Key inside value_type in case TrivialKey is a view type.
+    iterator operator[](const TrivialKey& k) {
+      KeyValuePair kv(k, Value());
+      return insert(kv).first;
+    }
+
+    void erase(iterator it) {
+      GOOGLE_DCHECK_EQ(it.m_, this);
+      it.revalidate_if_necessary();
+      const size_type index = it.index_;
+      GOOGLE_DCHECK_GE(ctrl_[index], 0);
+      alloc_.destroy(&slots_[index]);
+      --num_elements_;
+      // A lookup stops at the first group with an empty slot, so if this
+      // group still has one, no probe sequence ever went past it and the slot
+      // can become empty again.  Otherwise leave a tombstone.
+      const size_type group_start = index & ~(kGroupWidth - 1);
+      if (Group(ctrl_ + group_start).MatchEmpty() != 0) {
+        ctrl_[index] = kEmpty;
+        ++growth_left_;
+      } else {
+        ctrl_[index] = kDeleted;
+      }
+    }
+
+   private:
+    enum : size_type { kNotFound = ~static_cast<size_type>(0) };
+
+    const_iterator FindHelper(const TrivialKey& k) const {
+      const size_type index = FindIndex(k, Hash(k));
+      return index == kNotFound ? end() : const_iterator(this, index);
+    }
+
+    size_type FindIndex(const TrivialKey& k, uint64 hash) const {
+      const size_type group_mask = GroupMask();
+      const ctrl_t h2 = H2(hash);
+      size_type group = H1(hash) & group_mask;
+      for (size_type step = 1;; ++step) {
+        const size_type group_start = group * kGroupWidth;
+        Group g(ctrl_ + group_start);
+        for (uint32 match = g.Match(h2); match != 0; match &= match - 1) {
+          const size_type index = group_start + LowestBitIndex(match);
+          if (IsMatch(slots_[index].key(), k)) return index;
+        }
+        if (g.MatchEmpty() != 0) return kNotFound;
+        group = (group + step) & group_mask;
+      }
+    }
+
+    // Returns the first slot that is not full in the probe sequence of hash.
+    size_type FindFirstNonFull(uint64 hash) const {
+      const size_type group_mask = GroupMask();
+      size_type group = H1(hash) & group_mask;
+      for (size_type step = 1;; ++step) {
+        const size_type group_start = group * kGroupWidth;
+        uint32 mask = Group(ctrl_ + group_start).MatchEmptyOrDeleted();
+        if (mask != 0) return group_start + LowestBitIndex(mask);
+        group = (group + step) & group_mask;
+      }
+    }
+
+    // Claims a slot for a new element with the given hash, growing the table
+    // if necessary.  Requires that the key is not in the table.
+    size_type PrepareInsert(uint64 hash) {
+      size_type index = FindFirstNonFull(hash);
+      if (PROTOBUF_PREDICT_FALSE(growth_left_ == 0 &&
+                                 ctrl_[index] != kDeleted)) {
+        Grow();
+        index = FindFirstNonFull(hash);
+      }
+      if (ctrl_[index] == kEmpty) --growth_left_;
+      ctrl_[index] = H2(hash);
+      ++num_elements_;
+      return index;
+    }
+
+    // Makes room for at least one more element.  If most of the used slots are
+    // tombstones, rehashing in place is enough.
+    void Grow() {
+      if (num_slots_ > 0 && num_elements_ <= MaxLoad(num_slots_) / 2) {
+        Resize(num_slots_);
+      } else {
+        GOOGLE_CHECK_LE(num_slots_, max_size() / 2);
+        Resize(num_slots_ == 0 ? static_cast<size_type>(kGroupWidth)
+                               : num_slots_ * 2);
+      }
+    }
+
+    // Rehashes every element into a new table with new_num_slots slots.
+    void Resize(size_type new_num_slots) {
+      GOOGLE_DCHECK_GE(new_num_slots, kGroupWidth);
+      GOOGLE_DCHECK_EQ(new_num_slots & (new_num_slots - 1), 0);
+      ctrl_t* const old_ctrl = ctrl_;
+      KeyValuePair* const old_slots = slots_;
+      const size_type old_num_slots = num_slots_;
+      ctrl_ = Alloc<ctrl_t>(new_num_slots);
+      memset(ctrl_, kEmpty, new_num_slots);
+      slots_ = Alloc<KeyValuePair>(new_num_slots);
+      num_slots_ = new_num_slots;
+      growth_left_ = MaxLoad(new_num_slots) - num_elements_;
+      ++generation_;
+      for (size_type i = 0; i < old_num_slots; i++) {
+        if (old_ctrl[i] < 0) continue;
+        const uint64 hash = Hash(old_slots[i].key());
+        const size_type index = FindFirstNonFull(hash);
+        ctrl_[index] = H2(hash);
+        alloc_.construct(&slots_[index], old_slots[i]);
+      }
+      if (old_num_slots > 0) {
+        Dealloc<ctrl_t>(old_ctrl, old_num_slots);
+        Dealloc<KeyValuePair>(old_slots, old_num_slots);
+      }
+    }
+
+    // The number of elements (including tombstones) a table with num_slots
+    // slots may hold before it has to grow.
+    static size_type MaxLoad(size_type num_slots) {
+      return num_slots - num_slots / 8;
+    }
+
+    size_type GroupMask() const {
+      return num_slots_ == 0 ? 0 : num_slots_ / kGroupWidth - 1;
+    }
+
+    // Mixes the seed and the key's hash so that both the group index (H1) and
+    // the control byte (H2) depend on all bits of the hash.
+    uint64 Hash(const TrivialKey& k) const {
+      uint64 h = static_cast<uint64>(hash_function()(k) + seed_) *
+                 uint64{0x9E3779B97F4A7C15};
+      return h ^ (h >> 32);
+    }
+    static size_type H1(uint64 hash) { return static_cast<size_type>(hash >> 7); }
+    static ctrl_t H2(uint64 hash) { return static_cast<ctrl_t>(hash & 0x7F); }
+
+    static size_type LowestBitIndex(uint32 mask) {
+      return Bits::Log2FloorNonZero(mask & (~mask + 1));
+    }
+
+    bool IsMatch(const TrivialKey& k0, const TrivialKey& k1) const {
+      return k0 == k1;
+    }
+
+    // Return the number of slots needed to hold n elements without growing.
+    static size_type TableSize(size_type n) {
+      size_type num_slots = kGroupWidth;
+      while (MaxLoad(num_slots) < n) num_slots *= 2;
+      return num_slots;
+    }
+
+    // Control bytes for tables without slots: every lookup stops at once.
+    static ctrl_t* EmptyGroup() {
+      alignas(16) static const ctrl_t kEmptyGroup[kGroupWidth] = {
+          kEmpty, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty,
+          kEmpty, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty};
+      return const_cast<ctrl_t*>(kEmptyGroup);
+    }
+
+    // Use alloc_ to allocate an array of n objects of type U.
+    template <typename U>
+    U* Alloc(size_type n) {
+      using alloc_type = typename Allocator::template rebind<U>::other;
+      return alloc_type(alloc_).allocate(n);
+    }
+
+    // Use alloc_ to deallocate an array of n objects of type U.
+    template <typename U>
+    void Dealloc(U* t, size_type n) {
+      using alloc_type = typename Allocator::template rebind<U>::other;
+      alloc_type(alloc_).deallocate(t, n);
+    }
+
+    // Return a randomish value.
+    size_type Seed() const {
+      size_type s = static_cast<size_type>(reinterpret_cast<uintptr_t>(this));
+#if defined(__x86_64__) && defined(__GNUC__) && \
+    !defined(GOOGLE_PROTOBUF_NO_RDTSC)
+      uint32 hi, lo;
+      asm("rdtsc" : "=a"(lo), "=d"(hi));
+      s += ((static_cast<uint64>(hi) << 32) | lo);
+#endif
+      return s;
+    }
+
+    friend class Arena;
+    using InternalArenaConstructable_ = void;
+    using DestructorSkippable_ = void;
+
+    size_type num_elements_;
+    size_type num_slots_;
+    size_type growth_left_;  // Slots that may still be filled before growing.
+    size_type seed_;
+    size_type generation_;  // Incremented whenever slots move.
+    ctrl_t* ctrl_;          // num_slots_ control bytes, or EmptyGroup()
+    KeyValuePair* slots_;   // an array with num_slots_ entries
+    Allocator alloc_;
+    GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(InnerMap);
+  };  // end of class InnerMap
+
+#endif  // !GOOGLE_PROTOBUF_MAP_OPEN_ADDRESSING
+
  public:
   // Iterators
   class const_iterator {
@@ -1229,6 +1712,24 @@ class Map {
   hasher hash_function() const { return elements_->hash_function(); }
 
  private:
+  // Like operator[], but a new element takes its key over from key instead of
+  // copying it, and the returned flag tells whether the element is new. key
+  // is left untouched if it was already in the map. Used by the map entry
+  // parser, which reads each key into a temporary.
+  std::pair<iterator, bool> TryEmplaceInternal(Key&& key) {
+    typename InnerMap::iterator it = (*elements_)[key];
+    value_type** value = &it->value();
+    if (*value != nullptr) {
+      return std::pair<iterator, bool>(iterator(it), false);
+    }
+    *value = CreateValueTypeInternal(std::move(key));
+    // The inner map's key may be a view of key; point it at the element.
+    it->key() = (*value)->first;
+    internal::MapValueInitializer<is_proto_enum<T>::value, T>::Initialize(
+        (*value)->second, default_enum_value_);
+    return std::pair<iterator, bool>(iterator(it), true);
+  }
+
   // Set default enum value only for proto2 map field whose value is enum type.
   void SetDefaultEnumValue(int default_enum_value) {
     default_enum_value_ = default_enum_value;
@@ -1246,6 +1747,19 @@ class Map {
     }
   }
 
+  value_type* CreateValueTypeInternal(Key&& key) {
+    if (arena_ == nullptr) {
+      return new value_type(std::move(key));
+    } else {
+      value_type* value = reinterpret_cast<value_type*>(
+          Arena::CreateArray<uint8>(arena_, sizeof(value_type)));
+      Arena::CreateInArenaStorage(const_cast<Key*>(&value->first), arena_,
+                                  std::move(key));
+      Arena::CreateInArenaStorage(&value->second, arena_);
+      return value;
+    }
+  }
+
   value_type* CreateValueTypeInternal(const value_type& value) {
     if (arena_ == nullptr) {
       return new value_type(value);
@@ -1272,6 +1786,11 @@ class Map {
             internal::WireFormatLite::FieldType value_wire_type,
             int default_enum_value>
   friend class internal::MapFieldLite;
+  template <typename Derived, typename Base, typename K, typename V,
+            internal::WireFormatLite::FieldType key_wire_type,
+            internal::WireFormatLite::FieldType value_wire_type,
+            int default_enum_value>
+  friend class internal::MapEntryImpl;
 };
 
 }  // namespace protobuf
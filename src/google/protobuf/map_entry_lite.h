@@ -370,20 +370,20 @@ class MapEntryImpl : public Base {
         // We could use memcmp here, but we don't bother. The tag is one byte.
         static_assert(kTagSize == 1, "tag size must be 1");
         if (size > 0 && *reinterpret_cast<const char*>(data) == kValueTag) {
-          typename Map::size_type map_size = map_->size();
-          value_ptr_ = &(*map_)[key_];
-          if (PROTOBUF_PREDICT_TRUE(map_size != map_->size())) {
+          auto inserted = map_->TryEmplaceInternal(std::move(key_));
+          if (PROTOBUF_PREDICT_TRUE(inserted.second)) {
             // We created a new key-value pair.  Fill in the value.
             typedef
                 typename MapIf<ValueTypeHandler::kIsEnum, int*, Value*>::type T;
+            value_ptr_ = &inserted.first->second;
             input->Skip(kTagSize);  // Skip kValueTag.
             if (!ValueTypeHandler::Read(input,
                                         reinterpret_cast<T>(value_ptr_))) {
-              map_->erase(key_);  // Failure! Undo insertion.
+              map_->erase(inserted.first);  // Failure! Undo insertion.
               return false;
             }
             if (input->ExpectAtEnd()) return true;
-            return ReadBeyondKeyValuePair(input);
+            return ReadBeyondKeyValuePair(input, inserted.first);
           }
         }
       } else {
@@ -404,35 +404,42 @@ class MapEntryImpl : public Base {
           return nullptr;
         }
         if (PROTOBUF_PREDICT_TRUE(!ctx->Done(&ptr) && *ptr == kValueTag)) {
-          typename Map::size_type map_size = map_->size();
-          value_ptr_ = &(*map_)[key_];
-          if (PROTOBUF_PREDICT_TRUE(map_size != map_->size())) {
+          // The canonical encoding: the key, then the value.  The key moves
+          // into a new map element and the value is parsed in place, so no
+          // entry message is needed.
+          auto inserted = map_->TryEmplaceInternal(std::move(key_));
+          if (PROTOBUF_PREDICT_TRUE(inserted.second)) {
             using T =
                 typename MapIf<ValueTypeHandler::kIsEnum, int*, Value*>::type;
+            value_ptr_ = &inserted.first->second;
             ptr = ValueTypeHandler::Read(ptr + 1, ctx,
                                          reinterpret_cast<T>(value_ptr_));
             if (PROTOBUF_PREDICT_FALSE(!ptr ||
                                        !Derived::ValidateValue(value_ptr_))) {
-              map_->erase(key_);  // Failure! Undo insertion.
+              map_->erase(inserted.first);  // Failure! Undo insertion.
               return nullptr;
             }
             if (PROTOBUF_PREDICT_TRUE(ctx->Done(&ptr))) return ptr;
             if (!ptr) return nullptr;
+            // More fields follow the value.  Move what we have into an entry
+            // and let it parse the rest.
             NewEntry();
             ValueMover::Move(value_ptr_, entry_->mutable_value());
-            map_->erase(key_);
-            goto move_key;
+            *entry_->mutable_key() = inserted.first->first;
+            map_->erase(inserted.first);
+            goto parse_entry;
           }
+          // The key is already in the map; key_ was left as it is.
         } else {
           if (!ptr) return nullptr;
         }
         NewEntry();
-      move_key:
         KeyMover::Move(&key_, entry_->mutable_key());
       } else {
         if (!ptr) return nullptr;
         NewEntry();
       }
+    parse_entry:
       ptr = entry_->_InternalParse(ptr, ctx);
       if (ptr) UseKeyAndValueFromEntry();
       return ptr;
@@ -476,11 +483,12 @@ class MapEntryImpl : public Base {
     // After reading a key and value successfully, and inserting that data
     // into map_, we are not at the end of the input.  This is unusual, but
     // allowed by the spec.
-    bool ReadBeyondKeyValuePair(io::CodedInputStream* input) PROTOBUF_COLD {
+    bool ReadBeyondKeyValuePair(io::CodedInputStream* input,
+                                typename Map::iterator it) PROTOBUF_COLD {
       NewEntry();
       ValueMover::Move(value_ptr_, entry_->mutable_value());
-      map_->erase(key_);
-      KeyMover::Move(&key_, entry_->mutable_key());
+      *entry_->mutable_key() = it->first;
+      map_->erase(it);
       const bool result = entry_->MergePartialFromCodedStream(input);
       if (result) UseKeyAndValueFromEntry();
       return result;
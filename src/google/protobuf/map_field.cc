@@ -108,6 +108,9 @@ void MapFieldBase::SyncRepeatedFieldWithMap() const {
       mutex_.Unlock();
       break;
     case CLEAN:
+      // The repeated field is created before the state first becomes CLEAN,
+      // so normally there is nothing to do here and no need to lock.
+      if (PROTOBUF_PREDICT_TRUE(repeated_field_ != nullptr)) break;
       mutex_.Lock();
       // Double check state
       if (state_.load(std::memory_order_relaxed) == CLEAN) {
@@ -149,6 +152,11 @@ void MapFieldBase::SyncMapWithRepeatedField() const {
   }
 }
 
+Message* MapFieldBase::AddRepeatedEntry(const Message* prototype) const {
+  return reinterpret_cast<RepeatedPtrFieldBase*>(repeated_field_)
+      ->Add<GenericTypeHandler<Message> >(const_cast<Message*>(prototype));
+}
+
 // ------------------DynamicMapField------------------
 DynamicMapField::DynamicMapField(const Message* default_entry)
     : default_entry_(default_entry) {}
@@ -375,8 +383,7 @@ void DynamicMapField::SyncRepeatedFieldWithMapNoLock() const {
 
   for (Map<MapKey, MapValueRef>::const_iterator it = map_.begin();
        it != map_.end(); ++it) {
-    Message* new_entry = default_entry_->New(MapFieldBase::arena_);
-    MapFieldBase::repeated_field_->AddAllocated(new_entry);
+    Message* new_entry = AddRepeatedEntry(default_entry_);
     const MapKey& map_key = it->first;
     switch (key_des->cpp_type()) {
       case FieldDescriptor::CPPTYPE_STRING:
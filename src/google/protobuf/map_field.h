@@ -344,6 +344,11 @@ class PROTOBUF_EXPORT MapFieldBase {
   // Provides derived class the access to repeated field.
   void* MutableRepeatedPtrField() const;
 
+  // Appends an entry to the repeated field, which must exist, and returns it.
+  // Entries cleared by an earlier synchronization are reused; otherwise a new
+  // one is created from prototype.
+  Message* AddRepeatedEntry(const Message* prototype) const;
+
   enum State {
     STATE_MODIFIED_MAP = 0,       // map has newly added data that has not been
                                   // synchronized to repeated field
@@ -291,19 +291,14 @@ void MapField<Derived, Key, T, kKeyFieldType, kValueFieldType,
       reinterpret_cast<RepeatedPtrField<EntryType>*>(
           this->MapFieldBase::repeated_field_);
 
+  // Clear() keeps the entries around as cleared objects, and Add() reuses
+  // them, so synchronizing again after the map changed only allocates entries
+  // for the growth of the map.
   repeated_field->Clear();
 
-  // The only way we can get at this point is through reflection and the
-  // only way we can get the reflection object is by having called GetReflection
-  // on the encompassing field. So that type must have existed and hence we
-  // know that this MapEntry default_type has also already been constructed.
-  // So it's safe to just call internal_default_instance().
-  const Message* default_entry = Derived::internal_default_instance();
   for (typename Map<Key, T>::const_iterator it = map.begin(); it != map.end();
        ++it) {
-    EntryType* new_entry =
-        down_cast<EntryType*>(default_entry->New(this->MapFieldBase::arena_));
-    repeated_field->AddAllocated(new_entry);
+    EntryType* new_entry = repeated_field->Add();
     (*new_entry->mutable_key()) = it->first;
     (*new_entry->mutable_value()) = it->second;
   }
@@ -900,6 +900,45 @@ TEST_F(MapImplTest, Rehash) {
   EXPECT_TRUE(map_.empty());
 }
 
+// Erasing and inserting many different keys without growing the map exercises
+// reuse of erased entries.
+TEST_F(MapImplTest, EraseAndInsertChurn) {
+  std::map<int32, int32> reference_map;
+  for (int i = 0; i < 20000; i++) {
+    const int32 key = (i * 7919) % 1000 + (i / 1000) * 1000;
+    if (i % 3 == 2) {
+      EXPECT_EQ(reference_map.erase(key - 1000), map_.erase(key - 1000));
+    }
+    map_[key] = i;
+    reference_map[key] = i;
+    if (map_.size() > 500) {
+      const int32 old_key = reference_map.begin()->first;
+      reference_map.erase(old_key);
+      EXPECT_EQ(1, map_.erase(old_key));
+    }
+  }
+  EXPECT_EQ(reference_map.size(), map_.size());
+  for (const auto& entry : reference_map) {
+    ASSERT_TRUE(map_.contains(entry.first));
+    EXPECT_EQ(entry.second, map_.at(entry.first));
+  }
+}
+
+// The iterator returned by insert() must survive the map growing.
+TEST_F(MapImplTest, InsertedIteratorSurvivesGrowth) {
+  Map<std::string, int> map;
+  Map<std::string, int>::iterator it = map.insert({"key", 1}).first;
+  for (int i = 0; i < 1000; i++) {
+    map[StrCat(i)] = i;
+  }
+  EXPECT_EQ("key", it->first);
+  EXPECT_EQ(1, it->second);
+  EXPECT_TRUE(it == map.find("key"));
+  map.erase(it);
+  EXPECT_FALSE(map.contains("key"));
+  EXPECT_EQ(1000, map.size());
+}
+
 TEST_F(MapImplTest, EqualRange) {
   int key = 100, key_missing = 101;
   map_[key] = 100;
@@ -1003,6 +1042,29 @@ class MapFieldReflectionTest : public testing::Test {
               const Message& message) {
     return reflection->MapSize(message, field);
   }
+
+  bool InsertOrLookupMapValue(Message* message, const FieldDescriptor* field,
+                              const MapKey& key, MapValueRef* value) {
+    return message->GetReflection()->InsertOrLookupMapValue(message, field,
+                                                            key, value);
+  }
+
+  const MapFieldBase* GetMapData(const Message& message,
+                                 const FieldDescriptor* field) {
+    return message.GetReflection()->GetMapData(message, field);
+  }
+
+  // Checks that no map field of message has had its repeated field built.
+  void ExpectOnlyMapsValid(const Message& message) {
+    const Descriptor* descriptor = message.GetDescriptor();
+    for (int i = 0; i < descriptor->field_count(); i++) {
+      const FieldDescriptor* field = descriptor->field(i);
+      if (!field->is_map()) continue;
+      EXPECT_TRUE(GetMapData(message, field)->IsMapValid()) << field->name();
+      EXPECT_FALSE(GetMapData(message, field)->IsRepeatedFieldValid())
+          << field->name();
+    }
+  }
 };
 
 namespace {
@@ -1847,6 +1909,62 @@ TEST_F(MapFieldReflectionTest, UninitializedEntry) {
   EXPECT_FALSE(message.IsInitialized());
 }
 
+TEST_F(MapFieldReflectionTest, RepeatedFieldResyncReusesEntries) {
+  unittest::TestMap generated;
+  DynamicMessageFactory factory;
+  std::unique_ptr<Message> dynamic(
+      factory.GetPrototype(unittest::TestMap::descriptor())->New());
+  const FieldDescriptor* field =
+      unittest::TestMap::descriptor()->FindFieldByName("map_int32_int32");
+  MapReflectionTester reflection_tester(unittest::TestMap::descriptor());
+
+  for (Message* message : {static_cast<Message*>(&generated), dynamic.get()}) {
+    const Reflection* reflection = message->GetReflection();
+    reflection_tester.SetMapFieldsViaMapReflection(message);
+    const Message* entry = &reflection->GetRepeatedMessage(*message, field, 0);
+    const Message* last_entry =
+        &reflection->GetRepeatedMessage(*message, field, 1);
+
+    // Changing the map invalidates the repeated field, but building it again
+    // must not throw away the entries it already has.
+    MapKey key;
+    key.SetInt32Value(100);
+    MapValueRef value;
+    EXPECT_TRUE(InsertOrLookupMapValue(message, field, key, &value));
+    value.SetInt32Value(101);
+    EXPECT_FALSE(GetMapData(*message, field)->IsRepeatedFieldValid());
+
+    EXPECT_EQ(3, reflection->FieldSize(*message, field));
+    EXPECT_EQ(entry, &reflection->GetRepeatedMessage(*message, field, 0));
+    EXPECT_EQ(last_entry, &reflection->GetRepeatedMessage(*message, field, 1));
+  }
+}
+
+TEST_F(MapFieldReflectionTest, MergeBetweenGeneratedAndDynamicUsesMaps) {
+  unittest::TestMap generated;
+  MapTestUtil::SetMapFields(&generated);
+  ExpectOnlyMapsValid(generated);
+
+  DynamicMessageFactory factory;
+  std::unique_ptr<Message> dynamic(
+      factory.GetPrototype(unittest::TestMap::descriptor())->New());
+  dynamic->MergeFrom(generated);
+  ExpectOnlyMapsValid(generated);
+  ExpectOnlyMapsValid(*dynamic);
+
+  unittest::TestMap generated2;
+  generated2.MergeFrom(*dynamic);
+  ExpectOnlyMapsValid(*dynamic);
+  ExpectOnlyMapsValid(generated2);
+  MapTestUtil::ExpectMapFieldsSet(generated2);
+
+  // Merging again overwrites the values of existing keys.
+  MapTestUtil::ModifyMapFields(&generated);
+  dynamic->MergeFrom(generated);
+  generated2.MergeFrom(*dynamic);
+  MapTestUtil::ExpectMapFieldsModified(generated2);
+}
+
 // Generated Message Test ===========================================
 
 TEST(GeneratedMapFieldTest, Accessors) {
@@ -2383,6 +2501,34 @@ TEST(GeneratedMapFieldTest, UnknownFieldWireFormat) {
   EXPECT_EQ(3, message.map_int32_int32().at(2));
 }
 
+TEST(GeneratedMapFieldTest, StringKeyWireFormat) {
+  // The keys don't fit in std::string's inline buffer, so a key that was moved
+  // into the map and then read again would come out empty.
+  const std::string key1(40, 'a');
+  const std::string key2(40, 'b');
+  auto entry = [](const std::string& key, const std::string& value,
+                  const std::string& extra) {
+    std::string body = "\x0A" + std::string(1, key.size()) + key + "\x12" +
+                       std::string(1, value.size()) + value + extra;
+    return "\x72" + std::string(1, body.size()) + body;
+  };
+
+  // The second entry has an unknown field after the value and the third
+  // one repeats the first key.
+  unittest::TestMap message;
+  std::string data = entry(key1, "v1", "") +
+                     entry(key2, "v2", std::string("\x18\x01", 2)) +
+                     entry(key1, "v3", "");
+  ASSERT_TRUE(message.ParseFromString(data));
+  EXPECT_EQ(2, message.map_string_string().size());
+  EXPECT_EQ("v3", message.map_string_string().at(key1));
+  EXPECT_EQ("v2", message.map_string_string().at(key2));
+
+  // The value is cut short by the end of the entry.
+  data = entry(key1, "v1", "") + "\x72\x2D\x0A\x28" + key2 + "\x12\x05v";
+  EXPECT_FALSE(message.ParseFromString(data));
+}
+
 TEST(GeneratedMapFieldTest, CorruptedWireFormat) {
   unittest::TestMap message;
 
@@ -124,6 +124,8 @@ inline int ToIntSize(size_t size) {
 template <typename T>
 class ExplicitlyConstructed {
  public:
+  constexpr ExplicitlyConstructed() : union_{} {}
+
   void DefaultConstruct() { new (&union_) T(); }
 
   template <typename... Args>
@@ -58,8 +58,8 @@ namespace internal {
 // pointer.
 class InternalMetadata {
  public:
-  InternalMetadata() : ptr_(nullptr) {}
-  explicit InternalMetadata(Arena* arena) : ptr_(arena) {}
+  constexpr InternalMetadata() : ptr_(nullptr) {}
+  explicit constexpr InternalMetadata(Arena* arena) : ptr_(arena) {}
 
   template <typename T>
   void Delete() {
@@ -250,6 +250,13 @@ void byteswap<8>(void* p) {
 template <typename T>
 const char* EpsCopyInputStream::ReadPackedFixed(const char* ptr, int size,
                                                 RepeatedField<T>* out) {
+  // Grow once for the whole field instead of once per buffer chunk, but only
+  // if the declared size fits in the input, and never further than for
+  // strings.
+  if (PROTOBUF_PREDICT_TRUE(size <= buffer_end_ - ptr + limit_)) {
+    out->Reserve(out->size() + static_cast<int>(std::min<int>(
+                                   size, kSafeStringSize) / sizeof(T)));
+  }
   int nbytes = buffer_end_ + kSlopBytes - ptr;
   while (size > nbytes) {
     int num = nbytes / sizeof(T);
@@ -430,7 +437,8 @@ const char* InlineGreedyStringParser(std::string* s, const char* ptr,
 
 template <typename T, bool sign>
 const char* VarintParser(void* object, const char* ptr, ParseContext* ctx) {
-  return ctx->ReadPackedVarint(ptr, [object](uint64 varint) {
+  auto* field = static_cast<RepeatedField<T>*>(object);
+  return ctx->ReadPackedVarint(ptr, field, [field](uint64 varint) {
     T val;
     if (sign) {
       if (sizeof(T) == 8) {
@@ -441,7 +449,7 @@ const char* VarintParser(void* object, const char* ptr, ParseContext* ctx) {
     } else {
       val = varint;
     }
-    static_cast<RepeatedField<T>*>(object)->Add(val);
+    field->Add(val);
   });
 }
 
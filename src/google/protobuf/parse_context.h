@@ -179,6 +179,12 @@ class PROTOBUF_EXPORT EpsCopyInputStream {
   template <typename Add>
   PROTOBUF_MUST_USE_RESULT const char* ReadPackedVarint(const char* ptr,
                                                         Add add);
+  // Same as above, but first reserves room in *out for the values when the
+  // whole field is already buffered, so that add() never has to reallocate.
+  template <typename T, typename Add>
+  PROTOBUF_MUST_USE_RESULT const char* ReadPackedVarint(const char* ptr,
+                                                        RepeatedField<T>* out,
+                                                        Add add);
 
   uint32 LastTag() const { return last_tag_minus_1_ + 1; }
   bool ConsumeEndGroup(uint32 start_tag) {
@@ -281,6 +287,8 @@ class PROTOBUF_EXPORT EpsCopyInputStream {
   const char* SkipFallback(const char* ptr, int size);
   const char* AppendStringFallback(const char* ptr, int size, std::string* str);
   const char* ReadStringFallback(const char* ptr, int size, std::string* str);
+  template <typename Add>
+  const char* ReadPackedVarintBody(const char* ptr, int size, Add add);
   bool StreamNext(const void** data) {
     bool res = zcis_->Next(data, &size_);
     if (res) overall_limit_ -= size_;
@@ -618,10 +626,38 @@ PROTOBUF_MUST_USE_RESULT const char* ParseContext::ParseMessage(
   return ptr;
 }
 
+// Returns the number of varints ending in [ptr, ptr + size), which is the
+// number of bytes without a continuation bit.
+inline int CountVarints(const char* ptr, int size) {
+  int count = 0;
+  for (int i = 0; i < size; i++) {
+    count += static_cast<uint8>(ptr[i]) < 0x80;
+  }
+  return count;
+}
+
 template <typename Add>
 const char* EpsCopyInputStream::ReadPackedVarint(const char* ptr, Add add) {
   int size = ReadSize(&ptr);
   if (ptr == nullptr) return nullptr;
+  return ReadPackedVarintBody(ptr, size, add);
+}
+
+template <typename T, typename Add>
+const char* EpsCopyInputStream::ReadPackedVarint(const char* ptr,
+                                                 RepeatedField<T>* out,
+                                                 Add add) {
+  int size = ReadSize(&ptr);
+  if (ptr == nullptr) return nullptr;
+  if (size <= buffer_end_ + kSlopBytes - ptr) {
+    out->Reserve(out->size() + CountVarints(ptr, size));
+  }
+  return ReadPackedVarintBody(ptr, size, add);
+}
+
+template <typename Add>
+const char* EpsCopyInputStream::ReadPackedVarintBody(const char* ptr,
+                                                     int size, Add add) {
   auto old = PushLimit(ptr, size);
   if (old < 0) return nullptr;
   while (!DoneWithCheck(&ptr, -1)) {
@@ -749,10 +785,11 @@ PROTOBUF_MUST_USE_RESULT const
     char* PackedEnumParser(void* object, const char* ptr, ParseContext* ctx,
                            bool (*is_valid)(int), InternalMetadata* metadata,
                            int field_num) {
+  auto* field = static_cast<RepeatedField<int>*>(object);
   return ctx->ReadPackedVarint(
-      ptr, [object, is_valid, metadata, field_num](uint64 val) {
+      ptr, field, [field, is_valid, metadata, field_num](uint64 val) {
         if (is_valid(val)) {
-          static_cast<RepeatedField<int>*>(object)->Add(val);
+          field->Add(val);
         } else {
           WriteVarint(field_num, val, metadata->mutable_unknown_fields<T>());
         }
@@ -766,10 +803,11 @@ PROTOBUF_MUST_USE_RESULT const
                               bool (*is_valid)(const void*, int),
                               const void* data, InternalMetadata* metadata,
                               int field_num) {
+  auto* field = static_cast<RepeatedField<int>*>(object);
   return ctx->ReadPackedVarint(
-      ptr, [object, is_valid, data, metadata, field_num](uint64 val) {
+      ptr, field, [field, is_valid, data, metadata, field_num](uint64 val) {
         if (is_valid(data, val)) {
-          static_cast<RepeatedField<int>*>(object)->Add(val);
+          field->Add(val);
         } else {
           WriteVarint(field_num, val, metadata->mutable_unknown_fields<T>());
         }
@@ -103,6 +103,51 @@ void ReflectionOps::Merge(const Message& from, Message* to) {
           to_field->MergeFrom(*from_field);
           continue;
         }
+      } else if (field->is_map()) {
+        // A generated map merged with a dynamic one (or the reverse). The two
+        // map fields have different types, but as long as both are in map
+        // status we can still go entry by entry through the maps instead of
+        // building the repeated field on both sides.
+        const MapFieldBase* from_field =
+            from_reflection->GetMapData(from, field);
+        if (from_field->IsMapValid() &&
+            to_reflection->GetMapData(*to, field)->IsMapValid()) {
+          const FieldDescriptor* value_field =
+              field->message_type()->FindFieldByNumber(2);
+          for (MapIterator it = from_reflection->MapBegin(
+                   const_cast<Message*>(&from), field);
+               it != from_reflection->MapEnd(const_cast<Message*>(&from),
+                                             field);
+               ++it) {
+            MapValueRef to_value;
+            to_reflection->InsertOrLookupMapValue(to, field, it.GetKey(),
+                                                  &to_value);
+            const MapValueRef& from_value = it.GetValueRef();
+            switch (value_field->cpp_type()) {
+#define HANDLE_TYPE(CPPTYPE, METHOD)                              \
+  case FieldDescriptor::CPPTYPE_##CPPTYPE:                        \
+    to_value.Set##METHOD##Value(from_value.Get##METHOD##Value()); \
+    break;
+
+              HANDLE_TYPE(INT32, Int32);
+              HANDLE_TYPE(INT64, Int64);
+              HANDLE_TYPE(UINT32, UInt32);
+              HANDLE_TYPE(UINT64, UInt64);
+              HANDLE_TYPE(FLOAT, Float);
+              HANDLE_TYPE(DOUBLE, Double);
+              HANDLE_TYPE(BOOL, Bool);
+              HANDLE_TYPE(STRING, String);
+              HANDLE_TYPE(ENUM, Enum);
+#undef HANDLE_TYPE
+
+              case FieldDescriptor::CPPTYPE_MESSAGE:
+                to_value.MutableMessageValue()->CopyFrom(
+                    from_value.GetMessageValue());
+                break;
+            }
+          }
+          continue;
+        }
       }
       int count = from_reflection->FieldSize(from, field);
       for (int j = 0; j < count; j++) {
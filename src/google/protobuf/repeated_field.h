@@ -97,6 +97,12 @@ constexpr int kRepeatedFieldLowerClampLimit = 4;
 constexpr int kRepeatedFieldUpperClampLimit =
     (std::numeric_limits<int>::max() / 2) + 1;
 
+// kRepeatedPtrFieldMaxContiguousBytes bounds the size of the blocks that
+// RepeatedPtrField::AddContiguous() allocates, so that a large field doesn't
+// leave a whole growth step worth of unused elements on the arena.  It matches
+// the default maximum arena block size.
+constexpr int kRepeatedPtrFieldMaxContiguousBytes = 8192;
+
 // A utility function for logging that doesn't need any template types.
 void LogIndexOutOfBounds(int index, int size);
 
@@ -169,7 +175,7 @@ class RepeatedField final {
       "We only support types that have an alignment smaller than Arena");
 
  public:
-  RepeatedField();
+  constexpr RepeatedField();
   explicit RepeatedField(Arena* arena);
   RepeatedField(const RepeatedField& other);
   template <typename Iter>
@@ -309,8 +315,11 @@ class RepeatedField final {
 
   // Get the Arena on which this RepeatedField stores its elements.
   inline Arena* GetArena() const {
-    return (total_size_ == 0) ? static_cast<Arena*>(arena_or_elements_)
-                              : rep()->arena;
+    return (total_size_ == 0)
+               ? static_cast<Arena*>(arena_or_elements_)
+               : reinterpret_cast<Arena*>(
+                     reinterpret_cast<uintptr_t>(rep()->arena) &
+                     ~kInlineStorageTag);
   }
 
   // For internal use only.
@@ -318,6 +327,39 @@ class RepeatedField final {
   // This is public due to it being called by generated code.
   inline void InternalSwap(RepeatedField* other);
 
+  // Storage for the first N elements of a field, embedded next to the field
+  // in the object that owns it.  See InternalUseInlineStorage().
+  template <int N = internal::kRepeatedFieldLowerClampLimit>
+  struct InlineStorage {
+    Arena* arena;
+    Element elements[N];
+  };
+
+  // For internal use only.
+  //
+  // Makes an empty field that is not on an arena keep its first N elements in
+  // *storage rather than in a heap allocation.  The field only moves to the
+  // heap once it grows past N elements.  *storage must outlive the field and
+  // is never freed by it.  Does nothing for fields on an arena, where
+  // allocation is already cheap.  This is public due to it being called by
+  // generated code for fields with inline storage.
+  template <int N>
+  void InternalUseInlineStorage(InlineStorage<N>* storage);
+
+  // For internal use only.
+  //
+  // Like InternalSwap(), for fields that were given *storage and
+  // *other_storage with InternalUseInlineStorage().  Heap allocations change
+  // owners as usual, so this copies at most N elements however large the
+  // fields are.  InternalSwap() and Swap() do not know where a field's inline
+  // storage is, so when either field uses inline storage they copy all
+  // elements of both.  This is public due to it being called by generated
+  // code for fields with inline storage.
+  template <int N>
+  void InternalSwapWithInlineStorage(InlineStorage<N>* storage,
+                                     RepeatedField* other,
+                                     InlineStorage<N>* other_storage);
+
  private:
   static constexpr int kInitialSize = 0;
   // A note on the representation here (see also comment below for
@@ -342,6 +384,11 @@ class RepeatedField final {
   // Element is double and pointer is 32bit).
   static const size_t kRepHeaderSize;
 
+  // Set in Rep::arena when the Rep is an InlineStorage owned by someone else.
+  // Arena pointers are always aligned, so the bit is otherwise unused and
+  // masking it off yields the (null) arena.
+  static constexpr uintptr_t kInlineStorageTag = 1;
+
   // If total_size_ == 0 this points to an Arena otherwise it points to the
   // elements member of a Rep struct. Using this invariant allows the storage of
   // the arena pointer without an extra allocation in the constructor.
@@ -369,6 +416,16 @@ class RepeatedField final {
     return reinterpret_cast<Rep*>(addr);
   }
 
+  // Whether the elements live in an InlineStorage rather than an allocation.
+  bool UsesInlineStorage() const {
+    return total_size_ > 0 &&
+           (reinterpret_cast<uintptr_t>(rep()->arena) & kInlineStorageTag);
+  }
+
+  // Swaps contents element-wise; used when a field uses inline storage, which
+  // cannot change owners.
+  PROTOBUF_NOINLINE void SwapWithInlineStorage(RepeatedField* other);
+
   friend class Arena;
   typedef void InternalArenaConstructable_;
 
@@ -575,7 +632,7 @@ struct IsMovable
 //   };
 class PROTOBUF_EXPORT RepeatedPtrFieldBase {
  protected:
-  RepeatedPtrFieldBase();
+  constexpr RepeatedPtrFieldBase();
   explicit RepeatedPtrFieldBase(Arena* arena);
   ~RepeatedPtrFieldBase() {
 #ifndef NDEBUG
@@ -605,6 +662,8 @@ class PROTOBUF_EXPORT RepeatedPtrFieldBase {
   void Delete(int index);
   template <typename TypeHandler>
   typename TypeHandler::Type* Add(typename TypeHandler::Type* prototype = NULL);
+  template <typename TypeHandler>
+  typename TypeHandler::Type* AddContiguous();
 
  public:
   // The next few methods are public so that they can be called from generated
@@ -806,6 +865,9 @@ class GenericTypeHandler {
   }
   static inline GenericType* NewFromPrototype(const GenericType* prototype,
                                               Arena* arena = NULL);
+  // Creates `n` objects next to each other in a single allocation on `arena`,
+  // which must not be NULL, and returns a pointer to the first one.
+  static GenericType* NewBlock(Arena* arena, int n);
   static inline void Delete(GenericType* value, Arena* arena) {
     if (arena == NULL) {
       delete value;
@@ -832,6 +894,15 @@ GenericType* GenericTypeHandler<GenericType>::NewFromPrototype(
   return New(arena);
 }
 template <typename GenericType>
+GenericType* GenericTypeHandler<GenericType>::NewBlock(Arena* arena, int n) {
+  GOOGLE_DCHECK(arena != NULL);
+  GenericType* block = arena->CreateInternalRawArray<GenericType>(n);
+  for (int i = 0; i < n; i++) {
+    Arena::CreateInArenaStorage(block + i, arena);
+  }
+  return block;
+}
+template <typename GenericType>
 void GenericTypeHandler<GenericType>::Merge(const GenericType& from,
                                             GenericType* to) {
   to->MergeFrom(from);
@@ -915,7 +986,7 @@ class StringTypeHandler {
 template <typename Element>
 class RepeatedPtrField final : private internal::RepeatedPtrFieldBase {
  public:
-  RepeatedPtrField();
+  constexpr RepeatedPtrField();
   explicit RepeatedPtrField(Arena* arena);
 
   RepeatedPtrField(const RepeatedPtrField& other);
@@ -936,6 +1007,19 @@ class RepeatedPtrField final : private internal::RepeatedPtrFieldBase {
   Element* Add();
   void Add(Element&& value);
 
+  // Like Add(), but when the field is on an arena and there are no cleared
+  // elements left to reuse, the spare capacity of the field is filled with new
+  // elements allocated in one contiguous block of at most
+  // internal::kRepeatedPtrFieldMaxContiguousBytes (and at least one element);
+  // the extra ones are kept as cleared elements for subsequent calls.  Elements
+  // added this way sit next to each other in memory, which makes iterating
+  // over them cache friendly.  On the heap this is the same as Add().  Only
+  // available for message types.
+  template <typename E = Element,
+            typename = typename std::enable_if<
+                std::is_base_of<MessageLite, E>::value>::type>
+  Element* AddContiguous();
+
   const Element& operator[](int index) const { return Get(index); }
   Element& operator[](int index) { return *Mutable(index); }
 
@@ -1175,7 +1259,7 @@ class RepeatedPtrField final : private internal::RepeatedPtrFieldBase {
 // implementation ====================================================
 
 template <typename Element>
-inline RepeatedField<Element>::RepeatedField()
+constexpr RepeatedField<Element>::RepeatedField()
     : current_size_(0), total_size_(0), arena_or_elements_(nullptr) {}
 
 template <typename Element>
@@ -1447,6 +1531,12 @@ inline void RepeatedField<Element>::InternalSwap(RepeatedField* other) {
   GOOGLE_DCHECK(this != other);
   GOOGLE_DCHECK(GetArena() == other->GetArena());
 
+  if (PROTOBUF_PREDICT_FALSE(UsesInlineStorage() ||
+                             other->UsesInlineStorage())) {
+    SwapWithInlineStorage(other);
+    return;
+  }
+
   // Swap all fields at once.
   static_assert(std::is_standard_layout<RepeatedField<Element>>::value,
                 "offsetof() requires standard layout before c++17");
@@ -1457,6 +1547,72 @@ inline void RepeatedField<Element>::InternalSwap(RepeatedField* other) {
       reinterpret_cast<char*>(other) + offsetof(RepeatedField, current_size_));
 }
 
+template <typename Element>
+void RepeatedField<Element>::SwapWithInlineStorage(RepeatedField* other) {
+  // Inline storage is only used off arena, so both fields are on the heap.
+  RepeatedField<Element> temp;
+  temp.MergeFrom(*this);
+  CopyFrom(*other);
+  other->CopyFrom(temp);
+}
+
+template <typename Element>
+template <int N>
+void RepeatedField<Element>::InternalUseInlineStorage(
+    InlineStorage<N>* storage) {
+  static_assert(N >= internal::kRepeatedFieldLowerClampLimit,
+                "Inline storage must hold at least the minimum capacity");
+  static_assert(offsetof(InlineStorage<N>, elements) == offsetof(Rep, elements),
+                "InlineStorage must be layout compatible with Rep");
+  GOOGLE_DCHECK_EQ(total_size_, 0);
+  if (GetArena() != NULL) return;
+  storage->arena = reinterpret_cast<Arena*>(kInlineStorageTag);
+  for (int i = 0; i < N; i++) {
+    new (&storage->elements[i]) Element;
+  }
+  total_size_ = N;
+  arena_or_elements_ = storage->elements;
+}
+
+template <typename Element>
+template <int N>
+void RepeatedField<Element>::InternalSwapWithInlineStorage(
+    InlineStorage<N>* storage, RepeatedField* other,
+    InlineStorage<N>* other_storage) {
+  GOOGLE_DCHECK(this != other);
+  GOOGLE_DCHECK(GetArena() == other->GetArena());
+  const bool inline_here = UsesInlineStorage();
+  const bool inline_there = other->UsesInlineStorage();
+  GOOGLE_DCHECK(!inline_here || unsafe_elements() == storage->elements);
+  GOOGLE_DCHECK(!inline_there ||
+                other->unsafe_elements() == other_storage->elements);
+  if (!inline_here && !inline_there) {
+    InternalSwap(other);
+  } else if (inline_here && inline_there) {
+    // Both fields keep their storage; only the elements in use move.
+    const int n = std::max(current_size_, other->current_size_);
+    for (int i = 0; i < n; i++) {
+      std::swap(storage->elements[i], other_storage->elements[i]);
+    }
+    std::swap(current_size_, other->current_size_);
+  } else if (!inline_here) {
+    other->InternalSwapWithInlineStorage(other_storage, this, storage);
+  } else {
+    // Take over other's allocation (if any), and move our elements to
+    // other's own inline storage, which it is not using.
+    const int size = current_size_;
+    std::copy(storage->elements, storage->elements + size,
+              other_storage->elements);
+    current_size_ = other->current_size_;
+    total_size_ = other->total_size_;
+    arena_or_elements_ = other->arena_or_elements_;
+    other_storage->arena = reinterpret_cast<Arena*>(kInlineStorageTag);
+    other->current_size_ = size;
+    other->total_size_ = N;
+    other->arena_or_elements_ = other_storage->elements;
+  }
+}
+
 template <typename Element>
 void RepeatedField<Element>::Swap(RepeatedField* other) {
   if (this == other) return;
@@ -1514,7 +1670,9 @@ RepeatedField<Element>::cend() const {
 
 template <typename Element>
 inline size_t RepeatedField<Element>::SpaceUsedExcludingSelfLong() const {
-  return total_size_ > 0 ? (total_size_ * sizeof(Element) + kRepHeaderSize) : 0;
+  return total_size_ > 0 && !UsesInlineStorage()
+             ? (total_size_ * sizeof(Element) + kRepHeaderSize)
+             : 0;
 }
 
 namespace internal {
@@ -1635,7 +1793,7 @@ struct ElementCopier<Element, true> {
 
 namespace internal {
 
-inline RepeatedPtrFieldBase::RepeatedPtrFieldBase()
+constexpr RepeatedPtrFieldBase::RepeatedPtrFieldBase()
     : arena_(NULL), current_size_(0), total_size_(0), rep_(NULL) {}
 
 inline RepeatedPtrFieldBase::RepeatedPtrFieldBase(Arena* arena)
@@ -1740,6 +1898,29 @@ inline typename TypeHandler::Type* RepeatedPtrFieldBase::Add(
   return result;
 }
 
+template <typename TypeHandler>
+inline typename TypeHandler::Type* RepeatedPtrFieldBase::AddContiguous() {
+  if (arena_ == NULL) return Add<TypeHandler>();
+  if (rep_ != NULL && current_size_ < rep_->allocated_size) {
+    return cast<TypeHandler>(rep_->elements[current_size_++]);
+  }
+  if (!rep_ || rep_->allocated_size == total_size_) {
+    Reserve(total_size_ + 1);
+  }
+  // Fill the spare capacity at once, up to the block size limit; the elements
+  // beyond the one returned become cleared elements that the following adds
+  // pick up.
+  const int n = std::min<int>(
+      total_size_ - rep_->allocated_size,
+      std::max<int>(1, static_cast<int>(kRepeatedPtrFieldMaxContiguousBytes /
+                                        sizeof(typename TypeHandler::Type))));
+  typename TypeHandler::Type* block = TypeHandler::NewBlock(arena_, n);
+  for (int i = 0; i < n; i++) {
+    rep_->elements[rep_->allocated_size++] = block + i;
+  }
+  return cast<TypeHandler>(rep_->elements[current_size_++]);
+}
+
 template <typename TypeHandler,
           typename std::enable_if<TypeHandler::Movable::value>::type*>
 inline void RepeatedPtrFieldBase::Add(typename TypeHandler::Type&& value) {
@@ -2078,7 +2259,8 @@ class RepeatedPtrField<std::string>::TypeHandler
     : public internal::StringTypeHandler {};
 
 template <typename Element>
-inline RepeatedPtrField<Element>::RepeatedPtrField() : RepeatedPtrFieldBase() {}
+constexpr RepeatedPtrField<Element>::RepeatedPtrField()
+    : RepeatedPtrFieldBase() {}
 
 template <typename Element>
 inline RepeatedPtrField<Element>::RepeatedPtrField(Arena* arena)
@@ -2181,6 +2363,12 @@ inline Element* RepeatedPtrField<Element>::Add() {
   return RepeatedPtrFieldBase::Add<TypeHandler>();
 }
 
+template <typename Element>
+template <typename E, typename>
+inline Element* RepeatedPtrField<Element>::AddContiguous() {
+  return RepeatedPtrFieldBase::AddContiguous<TypeHandler>();
+}
+
 template <typename Element>
 inline void RepeatedPtrField<Element>::Add(Element&& value) {
   RepeatedPtrFieldBase::Add<TypeHandler>(std::move(value));
@@ -65,6 +65,105 @@ namespace {
 using ::protobuf_unittest::TestAllTypes;
 using ::testing::ElementsAre;
 
+TEST(RepeatedField, ConstInit) {
+  PROTOBUF_CONSTINIT static RepeatedField<int> field{};  // NOLINT
+  EXPECT_TRUE(field.empty());
+}
+
+TEST(RepeatedField, InlineStorage) {
+  RepeatedField<int>::InlineStorage<> storage1;
+  RepeatedField<int>::InlineStorage<> storage2;
+  RepeatedField<int> field1;
+  RepeatedField<int> field2;
+  field1.InternalUseInlineStorage(&storage1);
+  field2.InternalUseInlineStorage(&storage2);
+
+  EXPECT_TRUE(field1.empty());
+  EXPECT_EQ(field1.GetArena(), nullptr);
+  EXPECT_EQ(field1.Capacity(), internal::kRepeatedFieldLowerClampLimit);
+  for (int i = 0; i < field1.Capacity(); i++) {
+    field1.Add(i);
+  }
+  EXPECT_EQ(field1.data(), storage1.elements);
+  EXPECT_EQ(field1.SpaceUsedExcludingSelf(), 0);
+
+  // Growing past the inline capacity moves the elements to the heap.
+  field2.Add(42);
+  for (int i = 0; i < 16; i++) {
+    field2.Add(i * i);
+  }
+  EXPECT_NE(field2.data(), storage2.elements);
+  EXPECT_GT(field2.SpaceUsedExcludingSelf(), 0);
+
+  field1.Swap(&field2);
+  EXPECT_EQ(field1.size(), 17);
+  EXPECT_EQ(field1.Get(0), 42);
+  EXPECT_EQ(field1.Get(16), 225);
+  EXPECT_EQ(field2.size(), internal::kRepeatedFieldLowerClampLimit);
+  EXPECT_EQ(field2.Get(1), 1);
+
+  RepeatedField<int> copy(field2);
+  EXPECT_EQ(copy.size(), field2.size());
+  EXPECT_EQ(copy.Get(1), 1);
+  RepeatedField<int> moved(std::move(field2));
+  EXPECT_EQ(moved.size(), internal::kRepeatedFieldLowerClampLimit);
+  EXPECT_EQ(moved.Get(1), 1);
+}
+
+TEST(RepeatedField, InternalSwapWithInlineStorage) {
+  RepeatedField<int>::InlineStorage<> storage1;
+  RepeatedField<int>::InlineStorage<> storage2;
+  RepeatedField<int> field1;
+  RepeatedField<int> field2;
+  field1.InternalUseInlineStorage(&storage1);
+  field2.InternalUseInlineStorage(&storage2);
+
+  for (int i = 0; i < 100; i++) {
+    field1.Add(i);
+  }
+  field2.Add(-1);
+  const int* heap_data = field1.data();
+
+  // The heap allocation changes owners; only the inline element is copied.
+  field1.InternalSwapWithInlineStorage(&storage1, &field2, &storage2);
+  EXPECT_EQ(field2.data(), heap_data);
+  EXPECT_EQ(field2.size(), 100);
+  EXPECT_EQ(field2.Get(99), 99);
+  EXPECT_EQ(field1.data(), storage1.elements);
+  ASSERT_EQ(field1.size(), 1);
+  EXPECT_EQ(field1.Get(0), -1);
+
+  field1.InternalSwapWithInlineStorage(&storage1, &field2, &storage2);
+  EXPECT_EQ(field1.data(), heap_data);
+  EXPECT_EQ(field2.data(), storage2.elements);
+  ASSERT_EQ(field2.size(), 1);
+  EXPECT_EQ(field2.Get(0), -1);
+
+  // Both inline.
+  RepeatedField<int>::InlineStorage<> storage3;
+  RepeatedField<int> field3;
+  field3.InternalUseInlineStorage(&storage3);
+  field3.Add(7);
+  field3.Add(8);
+  field2.InternalSwapWithInlineStorage(&storage2, &field3, &storage3);
+  EXPECT_EQ(field2.data(), storage2.elements);
+  EXPECT_EQ(field3.data(), storage3.elements);
+  ASSERT_EQ(field2.size(), 2);
+  EXPECT_EQ(field2.Get(1), 8);
+  ASSERT_EQ(field3.size(), 1);
+  EXPECT_EQ(field3.Get(0), -1);
+}
+
+TEST(RepeatedField, InlineStorageOnArena) {
+  Arena arena;
+  RepeatedField<int>::InlineStorage<> storage;
+  RepeatedField<int>* field = Arena::CreateMessage<RepeatedField<int>>(&arena);
+  field->InternalUseInlineStorage(&storage);
+  field->Add(1);
+  EXPECT_EQ(field->GetArena(), &arena);
+  EXPECT_NE(field->data(), storage.elements);
+}
+
 // Test operations on a small RepeatedField.
 TEST(RepeatedField, Small) {
   RepeatedField<int> field;
@@ -811,6 +910,11 @@ TEST(RepeatedField, ClearThenReserveMore) {
 // RepeatedPtrField tests.  These pretty much just mirror the RepeatedField
 // tests above.
 
+TEST(RepeatedPtrField, ConstInit) {
+  PROTOBUF_CONSTINIT static RepeatedPtrField<std::string> field{};  // NOLINT
+  EXPECT_TRUE(field.empty());
+}
+
 TEST(RepeatedPtrField, Small) {
   RepeatedPtrField<std::string> field;
 
@@ -999,6 +1103,69 @@ TEST(RepeatedPtrField, ReserveDoesntLoseAllocated) {
   EXPECT_EQ(first, field.Add());
 }
 
+TEST(RepeatedPtrField, AddContiguous) {
+  Arena arena;
+  RepeatedPtrField<TestAllTypes>* field =
+      Arena::CreateMessage<RepeatedPtrField<TestAllTypes>>(&arena);
+
+  TestAllTypes* first = field->AddContiguous();
+  first->set_optional_int32(0);
+  // The first add fills the initial capacity with one block.
+  ASSERT_GT(field->Capacity(), 1);
+  for (int i = 1; i < field->Capacity(); i++) {
+    field->AddContiguous()->set_optional_int32(i);
+    EXPECT_EQ(first + i, &field->Get(i));
+  }
+
+  for (int i = field->size(); i < 100; i++) {
+    field->AddContiguous()->set_optional_int32(i);
+  }
+  ASSERT_EQ(100, field->size());
+  for (int i = 0; i < field->size(); i++) {
+    EXPECT_EQ(i, field->Get(i).optional_int32());
+    EXPECT_EQ(&arena, field->Get(i).GetArena());
+  }
+
+  // Cleared elements are reused before a new block is allocated.
+  TestAllTypes* last = field->Mutable(99);
+  field->RemoveLast();
+  EXPECT_EQ(last, field->AddContiguous());
+  EXPECT_EQ(0, last->optional_int32());
+}
+
+TEST(RepeatedPtrField, AddContiguousBlockSizeIsBounded) {
+  Arena arena;
+  RepeatedPtrField<TestAllTypes>* field =
+      Arena::CreateMessage<RepeatedPtrField<TestAllTypes>>(&arena);
+  field->Reserve(1000);
+
+  field->AddContiguous();
+  // Only one block's worth of the spare capacity is filled.
+  const int block_size =
+      std::max<int>(1, internal::kRepeatedPtrFieldMaxContiguousBytes /
+                           sizeof(TestAllTypes));
+  ASSERT_LT(block_size, 1000);
+  EXPECT_EQ(block_size - 1, field->ClearedCount());
+
+  for (int i = 1; i < 1000; i++) {
+    field->AddContiguous();
+  }
+  EXPECT_EQ(1000, field->size());
+  EXPECT_EQ(1000, field->Capacity());
+}
+
+TEST(RepeatedPtrField, AddContiguousOnHeap) {
+  RepeatedPtrField<TestAllTypes> field;
+  for (int i = 0; i < 10; i++) {
+    field.AddContiguous()->set_optional_int32(i);
+  }
+  ASSERT_EQ(10, field.size());
+  EXPECT_EQ(9, field.Get(9).optional_int32());
+  // Off arena, elements are allocated one by one as with Add().
+  field.Clear();
+  EXPECT_EQ(10, field.ClearedCount());
+}
+
 // Clearing elements is tricky with RepeatedPtrFields since the memory for
 // the elements is retained and reused.
 TEST(RepeatedPtrField, ClearedElements) {
@@ -166,6 +166,127 @@ TEST(WireFormatTest, ParseUnpackedFromPacked) {
   TestUtil::ExpectUnpackedFieldsSet(dest);
 }
 
+// Returns a length-delimited field with the given number whose payload is
+// the raw bytes in payload, preceded by a length of declared_length.
+std::string MakePackedField(int field_number, const std::string& payload,
+                            uint32 declared_length) {
+  std::string result;
+  {
+    io::StringOutputStream raw_output(&result);
+    io::CodedOutputStream output(&raw_output);
+    WireFormatLite::WriteTag(field_number,
+                             WireFormatLite::WIRETYPE_LENGTH_DELIMITED,
+                             &output);
+    output.WriteVarint32(declared_length);
+    output.WriteString(payload);
+  }
+  return result;
+}
+
+std::string EncodeVarints(const std::vector<uint64>& values) {
+  std::string result;
+  {
+    io::StringOutputStream raw_output(&result);
+    io::CodedOutputStream output(&raw_output);
+    for (uint64 value : values) output.WriteVarint64(value);
+  }
+  return result;
+}
+
+TEST(WireFormatTest, ParsePackedVarintReservesExactly) {
+  // Mix one-byte, multi-byte and ten-byte (negative) values.
+  std::vector<uint64> values;
+  for (int i = 0; i < 100; i++) {
+    values.push_back(
+        static_cast<uint64>(static_cast<int64>(i - 30) * (int64{1} << i % 20)));
+  }
+  std::string payload = EncodeVarints(values);
+  std::string data = MakePackedField(90, payload, payload.size());
+
+  unittest::TestPackedTypes message;
+  ASSERT_TRUE(message.ParseFromString(data));
+  ASSERT_EQ(values.size(), message.packed_int32_size());
+  for (int i = 0; i < values.size(); i++) {
+    EXPECT_EQ(static_cast<int32>(values[i]), message.packed_int32(i));
+  }
+  // The whole field was buffered, so it was sized exactly once up front.
+  EXPECT_EQ(values.size(), message.packed_int32().Capacity());
+}
+
+TEST(WireFormatTest, ParsePackedVarintAcrossChunks) {
+  std::vector<uint64> values;
+  for (int i = 0; i < 1000; i++) values.push_back(uint64{1} << (i % 64));
+  std::string payload = EncodeVarints(values);
+  std::string data = MakePackedField(93, payload, payload.size());
+
+  // A block size that is not a multiple of any varint length makes values
+  // straddle buffer boundaries.
+  io::ArrayInputStream raw_input(data.data(), data.size(), 7);
+  unittest::TestPackedTypes message;
+  ASSERT_TRUE(message.ParseFromZeroCopyStream(&raw_input));
+  ASSERT_EQ(values.size(), message.packed_uint64_size());
+  for (int i = 0; i < values.size(); i++) {
+    EXPECT_EQ(values[i], message.packed_uint64(i));
+  }
+}
+
+TEST(WireFormatTest, ParsePackedVarintMalformed) {
+  unittest::TestPackedTypes message;
+  std::string valid = EncodeVarints({1, 300, 70000});
+
+  // The last varint is cut off in the middle.
+  std::string truncated = valid + "\x80";
+  EXPECT_FALSE(message.ParseFromString(
+      MakePackedField(90, truncated, truncated.size())));
+
+  // A varint longer than ten bytes.
+  std::string overlong = valid + std::string(10, '\xff') + "\x01";
+  EXPECT_FALSE(message.ParseFromString(
+      MakePackedField(91, overlong, overlong.size())));
+
+  // The declared length runs past the end of the input.
+  EXPECT_FALSE(message.ParseFromString(
+      MakePackedField(92, valid, valid.size() + 1)));
+}
+
+TEST(WireFormatTest, ParsePackedEnumUnknownValues) {
+  // 99 and 100 are not ForeignEnum values, so they go to the unknown fields.
+  std::string payload = EncodeVarints({unittest::FOREIGN_FOO, 99,
+                                       unittest::FOREIGN_BAR, 100,
+                                       unittest::FOREIGN_BAZ});
+  std::string data = MakePackedField(103, payload, payload.size());
+
+  unittest::TestPackedTypes message;
+  ASSERT_TRUE(message.ParseFromString(data));
+  ASSERT_EQ(3, message.packed_enum_size());
+  EXPECT_EQ(unittest::FOREIGN_FOO, message.packed_enum(0));
+  EXPECT_EQ(unittest::FOREIGN_BAR, message.packed_enum(1));
+  EXPECT_EQ(unittest::FOREIGN_BAZ, message.packed_enum(2));
+
+  const UnknownFieldSet& unknown_fields =
+      message.GetReflection()->GetUnknownFields(message);
+  ASSERT_EQ(2, unknown_fields.field_count());
+  EXPECT_EQ(103, unknown_fields.field(0).number());
+  EXPECT_EQ(99, unknown_fields.field(0).varint());
+  EXPECT_EQ(103, unknown_fields.field(1).number());
+  EXPECT_EQ(100, unknown_fields.field(1).varint());
+
+  // Room is reserved for every value on the wire, including the ones that
+  // turn out to be unknown.
+  EXPECT_EQ(5, message.packed_enum().Capacity());
+}
+
+TEST(WireFormatTest, ParsePackedFixedLengthExceedsLimit) {
+  // Seven bytes claiming a 40MB packed fixed32 field must not make the parser
+  // reserve for the claimed length.
+  std::string data = MakePackedField(96, "x", 40000000);
+  ASSERT_EQ(7, data.size());
+
+  unittest::TestPackedTypes message;
+  EXPECT_FALSE(message.ParseFromString(data));
+  EXPECT_LT(message.packed_fixed32().Capacity(), 16);
+}
+
 TEST(WireFormatTest, ParsePackedExtensions) {
   unittest::TestPackedExtensions source, dest;
   std::string data;
@@ -49,6 +49,14 @@ build_cpp_tcmalloc() {
   PPROF_PATH=/usr/bin/google-pprof HEAPCHECK=strict ./protobuf-test
 }
 
+build_cpp_map_open_addressing() {
+  # google::protobuf::Map's layout depends on this option, so the library and
+  # the tests must both be built with it.
+  internal_build_cpp
+  ./configure --enable-map-open-addressing CXXFLAGS="-std=c++11" && \
+      make clean && make -j$(nproc) check || (cat src/test-suite.log; false)
+}
+
 build_cpp_distcheck() {
   grep -q -- "-Og" src/Makefile.am &&
     echo "The -Og flag is incompatible with Clang versions older than 4.0." &&
@@ -899,6 +907,7 @@ if [ "$#" -ne 1 ]; then
   echo "
 Usage: $0 { cpp |
             cpp_distcheck |
+            cpp_map_open_addressing |
             csharp |
             java_jdk7 |
             java_oracle7 |